@@ -7,7 +7,7 @@
 //
 // CREATED:         11/20/2021
 //
-// LAST EDITED:     01/06/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -30,64 +30,1077 @@
 // IN THE SOFTWARE.
 ////
 
-#include <assert.h>
-#include <stdbool.h>
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <handlebars/handlebars.h>
+#include <handlebars/helper.h>
 #include <handlebars/nary-tree.h>
 #include <handlebars/parser.h>
 #include <handlebars/scanner.h>
+#include <handlebars/symbol-table.h>
+#include <handlebars/template.h>
 #include <handlebars/vector.h>
 
-// This struct contains context necessary to parse the template and render it
-// using context.
-typedef struct HbsTemplate {
-    HbsNaryTree* components;
-} HbsTemplate;
+// Work shared by the threads of hbs_template_load_many(). Each thread claims
+// the next unclaimed path until there are none left, so that a few large
+// templates don't leave the other threads idle.
+typedef struct HbsLoadQueue {
+    const char* const* paths;
+    HbsTemplate** templates;
+    size_t length;
+    atomic_size_t next;
+    atomic_size_t failures;
+} HbsLoadQueue;
+
+// Input read from a buffer in memory, which needn't be NUL-terminated.
+typedef struct HbsBufferInput {
+    const char* buffer;
+    size_t length;
+    size_t position;
+} HbsBufferInput;
+
+// Outcome of the most recent load in each thread. <located> is only set if
+// the load failed with a syntax error that could be located.
+static _Thread_local HbsParseError last_error;
+static _Thread_local bool last_error_located;
 
 ///////////////////////////////////////////////////////////////////////////////
 // Private API
 ////
 
-int priv_render_substitution(HbsComponent* component, HbsString* string,
-    HbsHandlers* handlers)
+// Return true if <c> separates the segments of a path.
+static inline bool priv_is_separator(char c)
+{ return '.' == c || '/' == c; }
+
+// Return the length of the leading "this" or "." of <key>, which refers to the
+// current context, or zero if there isn't one.
+static size_t priv_path_prefix_length(const char* key) {
+    size_t length = 0;
+    if (0 == strncmp(key, "this", 4)) {
+        length = 4;
+    } else if ('.' == key[0]) {
+        length = 1;
+    }
+
+    // e.g. "thistle" is just a name, and ".." is not the current context.
+    if (0 < length && '\0' != key[length]
+        && (!priv_is_separator(key[length]) || '.' == key[1])) {
+        return 0;
+    }
+    return length;
+}
+
+// Split <key> into segments, storing them in <path>. The path's arrays are
+// allocated here.
+static int priv_split_path(const char* key, HbsSymbolTable* segments,
+    HbsPath* path)
 {
-    assert(NULL != handlers->key_handler);
-    const char* value = NULL;
-    HbsString* key = (HbsString*)component->argv->vector[0];
+    // Each "../" moves up to the context of the enclosing block.
+    size_t depth = 0;
+    while (0 == strncmp(key, "../", 3)) {
+        depth += 1;
+        key += 3;
+    }
+    if (0 == strcmp(key, "..")) {
+        depth += 1;
+        key = "this";
+    }
+
+    // Skip the separator following the prefix, too. The current context
+    // itself has no segments.
+    const size_t prefix = priv_path_prefix_length(key);
+    const char* name = key + prefix;
+    size_t length = 0;
+    if ('\0' != *name) {
+        name += 0 < prefix ? 1 : 0;
+        length = 1;
+        for (const char* c = name; '\0' != *c; ++c) {
+            length += priv_is_separator(*c) ? 1 : 0;
+        }
+    }
+
+    char* copy = malloc(strlen(name) + 1);
+    size_t* ids = calloc(length + 1, sizeof(size_t));
+    const char** names = calloc(length + 1, sizeof(const char*));
+    if (NULL == copy || NULL == ids || NULL == names) {
+        free(copy);
+        free(ids);
+        free(names);
+        return 1;
+    }
 
-    int result = handlers->key_handler(handlers->key_handler_data,
-        key->string, &value);
+    // Terminate each segment in place, then intern it.
+    strcpy(copy, name);
+    char* segment = copy;
+    int result = 0;
+    for (size_t i = 0; i < length && 0 == result; ++i) {
+        char* end = segment;
+        while ('\0' != *end && !priv_is_separator(*end)) {
+            ++end;
+        }
+        *end = '\0';
+
+        // Empty segments (e.g. "a..b" or "this.") aren't valid.
+        ids[i] = HBS_SYMBOL_NONE;
+        if (segment != end) {
+            ids[i] = hbs_symbol_table_intern(segments, segment);
+        }
+        result = HBS_SYMBOL_NONE == ids[i] ? 1 : 0;
+        segment = end + 1;
+    }
+
+    free(copy);
     if (0 != result) {
+        free(ids);
+        free(names);
+        return 1;
+    }
+
+    // Symbols are stable once interned, but the array holding them isn't.
+    const char* const* symbols = hbs_symbol_table_symbols(segments);
+    for (size_t i = 0; i < length; ++i) {
+        names[i] = symbols[ids[i]];
+    }
+
+    path->segments = names;
+    path->ids = ids;
+    path->length = length;
+    path->depth = depth;
+    return 0;
+}
+
+// Identify the data variable named by <name> (without the leading "@").
+static int priv_bind_data_variable(HbsComponent* component, const char* name)
+{
+    static const struct {
+        const char* name;
+        HbsDataVariable variable;
+    } variables[] = {
+        {"index", HBS_DATA_INDEX},
+        {"key", HBS_DATA_KEY},
+        {"first", HBS_DATA_FIRST},
+        {"last", HBS_DATA_LAST},
+    };
+
+    if (HBS_COMPONENT_EXPRESSION != component->type) {
         return 1;
     }
 
-    if (0 != hbs_string_append_str(string, value)) {
+    for (size_t i = 0; i < sizeof(variables) / sizeof(variables[0]); ++i) {
+        if (0 == strcmp(variables[i].name, name)) {
+            component->type = HBS_COMPONENT_DATA;
+            component->variable = variables[i].variable;
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// Find the innermost "{{#each}}" among the <depth> open <blocks>, and store
+// its distance from the innermost block in the data variable <component>.
+static int priv_bind_data_scope(HbsComponent* component,
+    HbsComponent* const* blocks, size_t depth)
+{
+    for (size_t i = depth; 0 < i; --i) {
+        if (HBS_BLOCK_EACH == blocks[i - 1]->block) {
+            component->path.depth = depth - i;
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// Copy the quoted string literal <text>, removing the quotes and backslash
+// escapes. Returns NULL if the literal isn't terminated by a matching quote.
+static char* priv_unescape_string(const char* text) {
+    const char quote = text[0];
+    char* string = malloc(strlen(text));
+    if (NULL == string) {
+        return NULL;
+    }
+
+    char* end = string;
+    const char* c = text + 1;
+    while ('\0' != *c && quote != *c) {
+        if ('\\' == *c && '\0' != c[1]) {
+            ++c;
+        }
+        *end++ = *c++;
+    }
+
+    if (quote != *c || '\0' != c[1]) {
+        free(string);
+        return NULL;
+    }
+
+    *end = '\0';
+    return string;
+}
+
+static inline const char* priv_skip_digits(const char* text) {
+    while (isdigit((unsigned char)*text)) {
+        ++text;
+    }
+    return text;
+}
+
+// Return true if <text> is a number literal, as Handlebars writes them:
+// -?digits(.digits)?([eE][+-]?digits)?. Anything else (e.g. "0x10", "inf"
+// or ".5") is a key.
+static bool priv_is_number(const char* text) {
+    text += '-' == *text ? 1 : 0;
+    if (!isdigit((unsigned char)*text)) {
+        return false;
+    }
+
+    text = priv_skip_digits(text);
+    if ('.' == *text) {
+        if (!isdigit((unsigned char)*++text)) {
+            return false;
+        }
+        text = priv_skip_digits(text);
+    }
+
+    if ('e' == *text || 'E' == *text) {
+        ++text;
+        text += '-' == *text || '+' == *text ? 1 : 0;
+        if (!isdigit((unsigned char)*text)) {
+            return false;
+        }
+        text = priv_skip_digits(text);
+    }
+
+    return '\0' == *text;
+}
+
+// Parse the number literal <text>. Integers that fit are kept exact.
+static int priv_parse_number(const char* text, HbsValue* value) {
+    char* end = NULL;
+    errno = 0;
+    const long long int_value = strtoll(text, &end, 10);
+    if ('\0' == *end && 0 == errno) {
+        value->type = HBS_VALUE_INT;
+        value->int_value = int_value;
+        return 0;
+    }
+
+    const double double_value = strtod(text, &end);
+    if ('\0' != *end) {
+        return 1;
+    }
+
+    value->type = HBS_VALUE_DOUBLE;
+    value->double_value = double_value;
+    return 0;
+}
+
+// Bind the helper argument written as <text>: either a literal string,
+// number, boolean or null, or otherwise a key, which is bound like the key of
+// an expression.
+static int priv_bind_operand(HbsStep* step, const char* text,
+    HbsSymbolTable* keys, HbsSymbolTable* segments)
+{
+    step->type = HBS_STEP_LITERAL;
+    if ('"' == text[0] || '\'' == text[0]) {
+        step->value.type = HBS_VALUE_STRING;
+        step->value.string = priv_unescape_string(text);
+        return NULL == step->value.string ? 1 : 0;
+    } else if (0 == strcmp("true", text) || 0 == strcmp("false", text)) {
+        step->value.type = HBS_VALUE_BOOL;
+        step->value.bool_value = 't' == text[0];
+        return 0;
+    } else if (0 == strcmp("null", text) || 0 == strcmp("undefined", text)) {
+        step->value.type = HBS_VALUE_NULL;
+        return 0;
+    } else if (priv_is_number(text)) {
+        return priv_parse_number(text, &step->value);
+    }
+
+    // Data variables aren't supported as arguments.
+    step->type = HBS_STEP_KEY;
+    step->key = text;
+    if ('@' == text[0]
+        || HBS_SYMBOL_NONE == hbs_symbol_table_intern(keys, text)) {
+        return 1;
+    }
+
+    return priv_split_path(text, segments, &step->path);
+}
+
+// Compile a call of <helper> with the arguments argv[begin] to argv[end - 1]
+// of <component> into steps, in postfix order, so that subexpressions are
+// evaluated before the calls that use their results. The number of operands
+// on the stack is tracked, so that renders can evaluate the steps on a
+// fixed-size stack.
+static int priv_bind_call(HbsComponent* component, size_t begin, size_t end,
+    const HbsHelper* helper, const HbsHelperRegistry* helpers,
+    HbsSymbolTable* keys, HbsSymbolTable* segments)
+{
+    // There's at most one step per argument, plus the outermost call.
+    component->steps = calloc(end - begin + 1, sizeof(HbsStep));
+    if (NULL == component->steps) {
+        return 1;
+    }
+
+    // Calls whose closing paren hasn't been reached yet, innermost last.
+    HbsStep calls[HBS_MAX_OPERAND_DEPTH];
+    calls[0] = (HbsStep){.type = HBS_STEP_CALL, .helper = helper};
+    size_t depth = 1;
+    size_t operands = 0;
+    for (size_t i = begin; i < end; ++i) {
+        const char* text = ((HbsString*)component->argv->vector[i])->string;
+        if (0 == strcmp("(", text)) {
+            // A subexpression must begin with the name of a helper.
+            const char* name = i + 1 < end
+                ? ((HbsString*)component->argv->vector[i + 1])->string : "";
+            const HbsHelper* inner = hbs_helper_registry_find(helpers, name);
+            if (NULL == inner || HBS_MAX_OPERAND_DEPTH == depth) {
+                return 1;
+            }
+            calls[depth++] = (HbsStep){.type = HBS_STEP_CALL, .helper = inner};
+            i += 1;
+            continue;
+        } else if (0 == strcmp(")", text)) {
+            if (1 == depth) {
+                return 1;
+            }
+            component->steps[component->step_count++] = calls[--depth];
+            operands -= calls[depth].argc;
+        } else if (0 != priv_bind_operand(
+                &component->steps[component->step_count++], text, keys,
+                segments)) {
+            return 1;
+        }
+
+        // Either way, one more operand for the enclosing call.
+        calls[depth - 1].argc += 1;
+        if (HBS_MAX_OPERAND_DEPTH < ++operands) {
+            return 1;
+        }
+    }
+
+    if (1 != depth) {
+        return 1;
+    }
+
+    component->steps[component->step_count++] = calls[0];
+    return 0;
+}
+
+// Bind a partial whose name is computed by a subexpression, e.g.
+// "{{> (concat 'card-' type)}}". Partials with static names are inlined when
+// a template set is linked, so they never get here.
+static int priv_bind_partial(HbsComponent* component,
+    const HbsHelperRegistry* helpers, HbsSymbolTable* keys,
+    HbsSymbolTable* segments)
+{
+    const size_t length = component->argv->length;
+    const char* first = ((HbsString*)component->argv->vector[0])->string;
+    const char* last = ((HbsString*)component->argv->vector[length - 1])
+        ->string;
+    if (NULL == helpers || 3 > length || 0 != strcmp("(", first)
+        || 0 != strcmp(")", last)) {
+        return 1;
+    }
+
+    const char* name = ((HbsString*)component->argv->vector[1])->string;
+    const HbsHelper* helper = hbs_helper_registry_find(helpers, name);
+    if (NULL == helper) {
+        return 1;
+    }
+
+    return priv_bind_call(component, 2, length - 1, helper, helpers, keys,
+        segments);
+}
+
+// Return the number of enclosing blocks that <component> refers to, through
+// its own key or the keys of its helper's arguments.
+static size_t priv_component_depth(const HbsComponent* component) {
+    size_t depth = component->path.depth;
+    for (size_t i = 0; i < component->step_count; ++i) {
+        if (depth < component->steps[i].path.depth) {
+            depth = component->steps[i].path.depth;
+        }
+    }
+
+    return depth;
+}
+
+// Determine the type of the block opened by <component>.
+static int priv_bind_block_type(HbsComponent* component) {
+    const char* name = ((HbsString*)component->argv->vector[0])->string;
+    if (0 == strcmp("with", name)) {
+        component->block = HBS_BLOCK_WITH;
+    } else if (0 == strcmp("each", name)) {
+        component->block = HBS_BLOCK_EACH;
+    } else {
+        return 1;
+    }
+
+    return 2 == component->argv->length ? 0 : 1;
+}
+
+// Pair the block close <component> at <position> with the innermost open
+// block, so that renders can jump between them.
+static int priv_bind_block_close(HbsComponent* component, size_t position,
+    HbsComponent* open, size_t open_position)
+{
+    const char* name = ((HbsString*)component->argv->vector[0])->string;
+    const char* open_name = ((HbsString*)open->argv->vector[0])->string;
+    if (0 != strcmp(name, open_name)) {
+        return 1;
+    }
+
+    component->block = open->block;
+    component->jump = position - open_position;
+    open->jump = component->jump;
+    return 0;
+}
+
+// Check that <component> may appear in <template>, and bind its keys.
+static int priv_bind_component(HbsTemplate* template, HbsComponent* component)
+{
+    if (HBS_COMPONENT_TEXT == component->type
+        || HBS_COMPONENT_BLOCK_CLOSE == component->type) {
+        return 0;
+    } else if (HBS_COMPONENT_BLOCK_OPEN == component->type
+        && 0 != priv_bind_block_type(component)) {
+        return 1;
+    } else if (HBS_COMPONENT_PARTIAL == component->type
+        && NULL == template->set) {
+        // Partials can only be resolved within a template set.
+        return 1;
+    } else if (HBS_COMPONENT_PARTIAL_BLOCK == component->type) {
+        // Template sets flatten partial blocks as they're linked.
+        return 1;
+    }
+
+    return hbs_component_bind(component, template->keys, template->segments,
+        template->helpers);
+}
+
+// The blocks enclosing a position in the template, innermost last.
+typedef struct HbsBlockStack {
+    HbsComponent* blocks[HBS_MAX_BLOCK_DEPTH];
+    size_t positions[HBS_MAX_BLOCK_DEPTH];
+    size_t depth;
+} HbsBlockStack;
+
+// Pair the bound <component> at <position> with the innermost block of
+// <stack> if it closes one, or push it if it opens one. Parent references
+// (e.g. "../key") are checked against the nesting of the blocks here, so
+// renders don't have to.
+static int priv_pair_component(HbsBlockStack* stack, HbsComponent* component,
+    size_t position)
+{
+    if (HBS_COMPONENT_TEXT == component->type) {
+        return 0;
+    } else if (HBS_COMPONENT_BLOCK_CLOSE == component->type) {
+        if (0 == stack->depth || 0 != priv_bind_block_close(component,
+                position, stack->blocks[stack->depth - 1],
+                stack->positions[stack->depth - 1])) {
+            return 1;
+        }
+        stack->depth -= 1;
+        return 0;
+    }
+
+    // The depth of a data variable is found from the enclosing blocks.
+    if (HBS_COMPONENT_DATA == component->type) {
+        if (0 != priv_bind_data_scope(component, stack->blocks,
+                stack->depth)) {
+            return 1;
+        }
+    } else if (priv_component_depth(component) > stack->depth) {
+        return 1;
+    }
+
+    if (HBS_COMPONENT_BLOCK_OPEN == component->type) {
+        if (HBS_MAX_BLOCK_DEPTH == stack->depth) {
+            return 1;
+        }
+        stack->blocks[stack->depth] = component;
+        stack->positions[stack->depth] = position;
+        stack->depth += 1;
+    }
+
+    return 0;
+}
+
+// Assign key slots to the expressions at positions <begin> to <end> - 1 of
+// the template (the others have been bound already), and pair up the open
+// and close components of each block.
+static int priv_template_bind(HbsTemplate* template, size_t begin, size_t end)
+{
+    HbsNaryTreeIter iterator;
+    hbs_nary_tree_iter_init(&iterator, template->components);
+    HbsNaryNode* element = NULL;
+    HbsNaryNode* root = hbs_nary_tree_get_root(template->components);
+
+    HbsBlockStack stack = {.depth = 0};
+    while (root != (element = hbs_nary_tree_iter_next(&iterator))) {
+        HbsComponent* component = hbs_nary_node_get_data(element);
+        const size_t position = iterator.index - 1;
+        if (begin <= position && position < end
+            && 0 != priv_bind_component(template, component)) {
+            return 1;
+        }
+
+        if (0 != priv_pair_component(&stack, component, position)) {
+            return 1;
+        }
+    }
+
+    return 0 == stack.depth ? 0 : 1;
+}
+
+static int priv_template_compile(HbsTemplate* template);
+
+// Parse the template from <input_context>, populating its components and key
+// table.
+static int priv_template_parse(HbsTemplate* template,
+    HbsInputContext* input_context)
+{
+    HbsScanner* scanner = hbs_scanner_new(input_context);
+    if (NULL == scanner) {
+        return 1;
+    }
+    HbsParser* parser = hbs_parser_new(scanner);
+    if (NULL == parser) {
+        hbs_scanner_free(scanner);
+        return 1;
+    }
+
+    int parse_result = hbs_parser_parse(parser, &template->components);
+    hbs_template_record_error(parser);
+    hbs_parser_free(parser);
+    hbs_scanner_free(scanner);
+    if (0 != parse_result) {
+        return 1;
+    }
+
+    return priv_template_compile(template);
+}
+
+// Create the key tables of <template>, and bind its components.
+static int priv_template_compile(HbsTemplate* template) {
+    template->keys = hbs_symbol_table_new();
+    template->segments = hbs_symbol_table_new();
+    if (NULL == template->keys || NULL == template->segments
+        || 0 != priv_template_bind(template, 0, SIZE_MAX)) {
+        return 1;
+    }
+
+    hbs_template_measure(template);
+    return 0;
+}
+
+static size_t priv_read_buffer(void* data, char* buffer, size_t buffer_size)
+{
+    HbsBufferInput* input = data;
+    size_t length = input->length - input->position;
+    if (length > buffer_size) {
+        length = buffer_size;
+    }
+
+    memcpy(buffer, input->buffer + input->position, length);
+    input->position += length;
+    return length;
+}
+
+// Parse the <length> bytes at <buffer>, which start at <offset> in the
+// source of the template, into <components>. The outcome is recorded for
+// hbs_template_last_error() if <record_error> is set.
+static int priv_parse_buffer(const char* buffer, size_t length, size_t offset,
+    bool record_error, HbsNaryTree** components)
+{
+    HbsBufferInput data = {buffer, length, 0};
+    HbsInputContext input = {priv_read_buffer, NULL, &data};
+    HbsScanner* scanner = hbs_scanner_new(&input);
+    if (NULL == scanner) {
+        return 1;
+    }
+    HbsParser* parser = hbs_parser_new(scanner);
+    if (NULL == parser) {
+        hbs_scanner_free(scanner);
+        return 1;
+    }
+
+    int result = hbs_parser_parse(parser, components);
+    if (record_error) {
+        hbs_template_record_error(parser);
+    }
+    hbs_parser_free(parser);
+    hbs_scanner_free(scanner);
+    if (0 != result) {
+        return 1;
+    }
+
+    HbsNaryTreeIter iterator;
+    hbs_nary_tree_iter_init(&iterator, *components);
+    HbsNaryNode* root = hbs_nary_tree_get_root(*components);
+    HbsNaryNode* element = NULL;
+    while (root != (element = hbs_nary_tree_iter_next(&iterator))) {
+        ((HbsComponent*)hbs_nary_node_get_data(element))->offset += offset;
+    }
+    return 0;
+}
+
+// Release the components and key table of the template.
+static void priv_template_unload(HbsTemplate* template) {
+    if (NULL != template->components) {
+        hbs_nary_tree_free(template->components);
+        template->components = NULL;
+    }
+
+    if (NULL != template->keys) {
+        hbs_symbol_table_free(template->keys);
+        template->keys = NULL;
+    }
+
+    if (NULL != template->segments) {
+        hbs_symbol_table_free(template->segments);
+        template->segments = NULL;
+    }
+
+    hbs_template_measure(template);
+}
+
+// Read all of <input_context> into a string.
+static HbsString* priv_read_input(HbsInputContext* input_context) {
+    HbsString* source = hbs_string_new();
+    if (NULL == source) {
+        return NULL;
+    }
+
+    char buffer[4096];
+    size_t length = 0;
+    while (0 < (length = input_context->read(input_context->data, buffer,
+                sizeof(buffer)))) {
+        if (0 != hbs_string_append_buffer(source, buffer, length)) {
+            hbs_string_free(source);
+            return NULL;
+        }
+    }
+
+    return source;
+}
+
+// Replace the components and key tables of <template> with those parsed from
+// <source>, unless it fails to load.
+static int priv_reparse_all(HbsTemplate* template, const HbsString* source) {
+    HbsTemplate parsed = {.helpers = template->helpers, .set = template->set};
+    if (0 != priv_parse_buffer(source->string, source->length, 0, true,
+            &parsed.components)
+        || 0 != priv_template_compile(&parsed)) {
+        priv_template_unload(&parsed);
         return 1;
     }
+
+    priv_template_unload(template);
+    template->components = parsed.components;
+    template->keys = parsed.keys;
+    template->segments = parsed.segments;
+    template->shift_position = 0;
+    template->shift = 0;
+    hbs_template_measure(template);
     return 0;
 }
 
-int priv_render_component(HbsComponent* component, HbsString* result,
-    HbsHandlers* handlers)
+static inline HbsComponent* priv_component_at(HbsNaryTree* components,
+    size_t position)
+{
+    return hbs_nary_node_get_data(hbs_nary_tree_node_at(components, position));
+}
+
+// Return the offset in the source of the component at <position>, including
+// the shift that's pending for it.
+static size_t priv_component_offset(const HbsTemplate* template,
+    size_t position)
 {
-    switch (component->type) {
-    case HBS_COMPONENT_TEXT:
-        return hbs_string_append(result, component->text);
+    const size_t offset = priv_component_at(template->components,
+        position)->offset;
+    return position >= template->shift_position
+        ? offset + template->shift : offset;
+}
 
-    case HBS_COMPONENT_EXPRESSION: {
-        if (1 == component->argv->length) {
-            return priv_render_substitution(component, result, handlers);
+// Return the position of the component containing byte <offset> of the
+// source, or <count> if it's at the end. The components cover the source in
+// order, without gaps.
+static size_t priv_find_component(const HbsTemplate* template, size_t count,
+    size_t offset)
+{
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        const size_t begin = priv_component_offset(template, middle);
+        const size_t length = priv_component_at(template->components,
+            middle)->length;
+        if (offset < begin) {
+            high = middle;
+        } else if (offset >= begin + length) {
+            low = middle + 1;
         } else {
+            return middle;
+        }
+    }
+
+    return low;
+}
+
+// Move the start of the pending shift to <position>, applying it to (or
+// taking it back from) the components in between. Successive edits tend to
+// be close together, so this rarely has far to go.
+static void priv_move_shift(HbsTemplate* template, size_t position) {
+    if (0 == template->shift) {
+        template->shift_position = position;
+        return;
+    }
+
+    HbsNaryTree* components = template->components;
+    for (; template->shift_position < position;
+         ++template->shift_position) {
+        priv_component_at(components, template->shift_position)->offset
+            += template->shift;
+    }
+    for (; template->shift_position > position;
+         --template->shift_position) {
+        priv_component_at(components, template->shift_position - 1)->offset
+            -= template->shift;
+    }
+}
+
+// The blocks that a run of components closes without opening, and the
+// positions of those that it opens without closing.
+typedef struct HbsBlockShape {
+    size_t closed;
+    size_t opened;
+    size_t positions[HBS_MAX_BLOCK_DEPTH];
+} HbsBlockShape;
+
+// Find the shape of the <count> components of <components> at <position>.
+// Returns non-zero if they open too many blocks.
+static int priv_block_shape(HbsNaryTree* components, size_t position,
+    size_t count, HbsBlockShape* shape)
+{
+    shape->closed = 0;
+    shape->opened = 0;
+    for (size_t i = position; i < position + count; ++i) {
+        const HbsComponent* component = priv_component_at(components, i);
+        if (HBS_COMPONENT_BLOCK_OPEN == component->type) {
+            if (HBS_MAX_BLOCK_DEPTH == shape->opened) {
+                return 1;
+            }
+            shape->positions[shape->opened++] = i;
+        } else if (HBS_COMPONENT_BLOCK_CLOSE == component->type) {
+            if (0 < shape->opened) {
+                shape->opened -= 1;
+            } else {
+                shape->closed += 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// Return true if the components replaced by an edit, whose shape is
+// <replaced> in the tree <removed>, and those that replaced them, whose
+// shape is <shape> in <components>, affect the blocks around them in the
+// same way, so that the rest of the template pairs up as it did before.
+static bool priv_shape_equal(HbsNaryTree* removed,
+    const HbsBlockShape* replaced, HbsNaryTree* components,
+    const HbsBlockShape* shape)
+{
+    if (replaced->closed != shape->closed
+        || replaced->opened != shape->opened) {
+        return false;
+    }
+
+    for (size_t i = 0; i < shape->opened; ++i) {
+        const HbsComponent* old_open = priv_component_at(removed,
+            replaced->positions[i]);
+        const HbsComponent* open = priv_component_at(components,
+            shape->positions[i]);
+        if (0 != strcmp(((HbsString*)old_open->argv->vector[0])->string,
+                ((HbsString*)open->argv->vector[0])->string)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Find the blocks which enclose <position>, by walking back over the
+// components before it, skipping over the blocks that are closed.
+static int priv_find_blocks(HbsNaryTree* components, size_t position,
+    HbsBlockStack* stack)
+{
+    stack->depth = 0;
+    while (0 < position--) {
+        HbsComponent* component = priv_component_at(components, position);
+        if (HBS_COMPONENT_BLOCK_CLOSE == component->type) {
+            position -= component->jump;
+        } else if (HBS_COMPONENT_BLOCK_OPEN == component->type) {
+            if (HBS_MAX_BLOCK_DEPTH == stack->depth) {
+                return 1;
+            }
+            stack->blocks[stack->depth] = component;
+            stack->positions[stack->depth] = position;
+            stack->depth += 1;
+        }
+    }
+
+    // The blocks were found innermost first.
+    for (size_t i = 0; i < stack->depth / 2; ++i) {
+        const size_t j = stack->depth - 1 - i;
+        HbsComponent* block = stack->blocks[i];
+        const size_t block_position = stack->positions[i];
+        stack->blocks[i] = stack->blocks[j];
+        stack->positions[i] = stack->positions[j];
+        stack->blocks[j] = block;
+        stack->positions[j] = block_position;
+    }
+    return 0;
+}
+
+// Bind the <parsed> components at <first>, which replaced the components of
+// <removed>, and pair up their blocks. If <local>, the edit affects the
+// blocks around it as the replaced components did (see priv_shape_equal()),
+// so only the blocks enclosing or crossing it are paired again, and they're
+// left as they were if this fails. Otherwise, the whole template is paired.
+static int priv_bind_edit(HbsTemplate* template, size_t first, size_t parsed,
+    HbsNaryTree* removed, const HbsBlockShape* replaced, bool local)
+{
+    HbsNaryTree* components = template->components;
+    for (size_t i = first; i < first + parsed; ++i) {
+        if (0 != priv_bind_component(template,
+                priv_component_at(components, i))) {
+            return 1;
+        }
+    }
+
+    if (!local) {
+        return priv_template_bind(template, 0, 0);
+    }
+
+    // Pairing the new components may close some of the enclosing blocks.
+    HbsBlockStack stack;
+    if (0 != priv_find_blocks(components, first, &stack)) {
+        return 1;
+    }
+
+    const HbsBlockStack enclosing = stack;
+    size_t jumps[HBS_MAX_BLOCK_DEPTH];
+    for (size_t i = 0; i < enclosing.depth; ++i) {
+        jumps[i] = enclosing.blocks[i]->jump;
+    }
+
+    for (size_t i = first; i < first + parsed; ++i) {
+        if (0 != priv_pair_component(&stack, priv_component_at(components, i),
+                i)) {
+            for (size_t j = 0; j < enclosing.depth; ++j) {
+                enclosing.blocks[j]->jump = jumps[j];
+            }
             return 1;
         }
     }
 
-    default:
-        return HBS_ERROR;
+    // The enclosing blocks which are still open close after the edit, so
+    // their ends are now <parsed> - <replaced> components further apart.
+    const size_t count = hbs_nary_tree_length(removed) - 1;
+    const size_t outer = enclosing.depth - replaced->closed;
+    for (size_t i = 0; i < outer; ++i) {
+        HbsComponent* open = stack.blocks[i];
+        open->jump += parsed - count;
+        priv_component_at(components, stack.positions[i] + open->jump)->jump
+            = open->jump;
+    }
+
+    // The blocks opened by the edit are closed by the components that closed
+    // the blocks it replaced, whose names match, so pairing them can't fail.
+    for (size_t i = 0; i < replaced->opened; ++i) {
+        const HbsComponent* old_open = priv_component_at(removed,
+            replaced->positions[i]);
+        const size_t close = first + replaced->positions[i] + old_open->jump
+            + parsed - count;
+        priv_bind_block_close(priv_component_at(components, close), close,
+            stack.blocks[outer + i], stack.positions[outer + i]);
     }
+    return 0;
+}
+
+// Reparse the components of <template> affected by replacing <removed> bytes
+// at <offset> of its source with <inserted> bytes, which produced <source>.
+// The region that's reparsed starts just after a handlebars expression before
+// the edit (where the scanner's state doesn't depend on anything before it),
+// and ends just before one after the edit, once the region parses by itself,
+// which is where the tokens of the old and new sources fall back into step.
+// Only the new components are bound and measured, and the offsets of those
+// after them are shifted lazily. If the result doesn't load, the template is
+// left as it was.
+static int priv_reparse_edit(HbsTemplate* template, const HbsString* source,
+    size_t offset, size_t removed, size_t inserted)
+{
+    HbsNaryTree* components = template->components;
+    const size_t count = hbs_nary_tree_length(components) - 1;
+    const size_t old_length = source->length + removed - inserted;
+    size_t first = priv_find_component(template, count, offset);
+    while (0 < first && HBS_COMPONENT_TEXT
+           == priv_component_at(components, first - 1)->type) {
+        first -= 1;
+    }
+
+    // The component following the edit is included, in case the edit joins
+    // onto it.
+    size_t last = priv_find_component(template, count, offset + removed);
+    last += last < count ? 1 : 0;
+    const size_t begin = first < count
+        ? priv_component_offset(template, first) : old_length;
+    HbsNaryTree* region = NULL;
+    for (;;) {
+        while (last < count && HBS_COMPONENT_TEXT
+               == priv_component_at(components, last)->type) {
+            last += 1;
+        }
+
+        // A region ending in "{" would start the expression after it. Errors
+        // in the region aren't reported, since they're only tentative.
+        const size_t end = (last < count
+            ? priv_component_offset(template, last) : old_length)
+            + inserted - removed;
+        if ((count == last || begin == end
+                || '{' != source->string[end - 1])
+            && 0 == priv_parse_buffer(source->string + begin, end - begin,
+                begin, false, &region)) {
+            break;
+        } else if (count == last) {
+            return 1;
+        }
+        last += 1;
+    }
+
+    // The components before <last> are brought up to date, so that the
+    // shift of this edit can be added to the pending one.
+    priv_move_shift(template, last);
+    const size_t parsed = hbs_nary_tree_length(region) - 1;
+    if (0 != hbs_nary_tree_splice(components, first, last - first, region)) {
+        hbs_nary_tree_free(region);
+        return 1;
+    }
+
+    // <region> now holds the components that were replaced.
+    template->shift_position = first + parsed;
+    template->shift += inserted - removed;
+    HbsBlockShape replaced;
+    HbsBlockShape shape;
+    const bool local = 0 == priv_block_shape(region, 0, last - first,
+            &replaced)
+        && 0 == priv_block_shape(components, first, parsed, &shape)
+        && priv_shape_equal(region, &replaced, components, &shape);
+    if (0 != priv_bind_edit(template, first, parsed, region, &replaced,
+            local)) {
+        // Put the old components back. Their blocks were paired before, so
+        // pairing them again can't fail.
+        hbs_nary_tree_splice(components, first, parsed, region);
+        template->shift_position = last;
+        template->shift -= inserted - removed;
+        if (!local) {
+            priv_template_bind(template, 0, 0);
+        }
+        hbs_nary_tree_free(region);
+        return 1;
+    }
+
+    hbs_template_measure_splice(template, first, parsed, region);
+    hbs_nary_tree_free(region);
+    return 0;
+}
+
+static int priv_fingerprint_file(const char* path,
+    HbsFingerprint* fingerprint)
+{
+    struct stat status;
+    if (0 != stat(path, &status)) {
+        return 1;
+    }
+
+    memset(fingerprint, 0, sizeof(HbsFingerprint));
+    fingerprint->size = status.st_size;
+    fingerprint->modified = status.st_mtim;
+    return 0;
+}
+
+static inline bool priv_fingerprint_equal(const HbsFingerprint* first,
+    const HbsFingerprint* second)
+{
+    return first->size == second->size
+        && first->modified.tv_sec == second->modified.tv_sec
+        && first->modified.tv_nsec == second->modified.tv_nsec;
+}
+
+// Slow path of hbs_template_acquire(): parse a lazy template, at most once.
+// The file must not have changed since the template was created, since the
+// keys and segments of the template may already have been used by handlers.
+static int priv_template_load_lazy(HbsTemplate* template) {
+    int result = 0;
+    pthread_mutex_lock(&template->lock);
+    if (HBS_TEMPLATE_READY != atomic_load(&template->state)) {
+        HbsInputContext* input = NULL;
+        HbsFingerprint fingerprint;
+        if (0 == priv_fingerprint_file(template->path, &fingerprint)
+            && priv_fingerprint_equal(&fingerprint, &template->fingerprint)) {
+            input = hbs_input_context_from_file(template->path);
+        }
+
+        result = 1;
+        if (NULL != input) {
+            result = priv_template_parse(template, input);
+            hbs_input_context_free(input);
+        }
+
+        if (0 == result) {
+            atomic_store(&template->state, HBS_TEMPLATE_READY);
+        } else {
+            priv_template_unload(template);
+        }
+    }
+
+    pthread_mutex_unlock(&template->lock);
+    return result;
+}
+
+// Thread entrypoint for hbs_template_load_many(). Every load uses its own
+// scanner and parser, so there's no state shared between the threads.
+static void* priv_load_worker(void* data) {
+    HbsLoadQueue* queue = (HbsLoadQueue*)data;
+    size_t index = 0;
+    while ((index = atomic_fetch_add(&queue->next, 1)) < queue->length) {
+        HbsTemplate* template = NULL;
+        HbsInputContext* input = hbs_input_context_from_file(
+            queue->paths[index]);
+        if (NULL != input) {
+            template = hbs_template_load(input);
+            hbs_input_context_free(input);
+        }
+
+        queue->templates[index] = template;
+        if (NULL == template) {
+            atomic_fetch_add(&queue->failures, 1);
+        }
+    }
+
+    return NULL;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -99,29 +1112,125 @@ int priv_render_component(HbsComponent* component, HbsString* result,
 // contents of that file as it is on disk currently. The template is not
 // reloaded every time the template is rendered (unless explicitly done so).
 HbsTemplate* hbs_template_load(HbsInputContext* input_context) {
+    return hbs_template_load_with_helpers(input_context, NULL);
+}
+
+// Load a template which may call the helpers in <registry>.
+HbsTemplate* hbs_template_load_with_helpers(HbsInputContext* input_context,
+    const HbsHelperRegistry* registry)
+{
     HbsTemplate* template = malloc(sizeof(HbsTemplate));
     if (NULL == template) {
         return NULL;
     }
 
-    HbsScanner* scanner = hbs_scanner_new(input_context);
-    if (NULL == scanner) {
-        free(template);
+    memset(template, 0, sizeof(HbsTemplate));
+    atomic_init(&template->state, HBS_TEMPLATE_READY);
+    atomic_init(&template->renders, 0);
+    template->helpers = registry;
+    if (0 != priv_template_parse(template, input_context)) {
+        hbs_template_free(template);
         return NULL;
     }
-    HbsParser* parser = hbs_parser_new(scanner);
-    if (NULL == parser) {
-        hbs_scanner_free(scanner);
-        free(template);
+
+    return template;
+}
+
+// Load a template which keeps its source, so that it can be edited with
+// hbs_template_apply_edit().
+HbsTemplate* hbs_template_load_editable(HbsInputContext* input_context,
+    const HbsHelperRegistry* registry)
+{
+    HbsTemplate* template = malloc(sizeof(HbsTemplate));
+    if (NULL == template) {
         return NULL;
     }
 
     memset(template, 0, sizeof(HbsTemplate));
-    int parse_result = hbs_parser_parse(parser, &template->components);
+    atomic_init(&template->state, HBS_TEMPLATE_READY);
+    atomic_init(&template->renders, 0);
+    template->helpers = registry;
+    template->source = priv_read_input(input_context);
+    if (NULL == template->source
+        || 0 != priv_reparse_all(template, template->source)) {
+        hbs_template_free(template);
+        return NULL;
+    }
 
-    hbs_parser_free(parser);
-    hbs_scanner_free(scanner);
-    if (0 != parse_result) {
+    return template;
+}
+
+// Apply the edit to the source, and reparse as little of it as possible. Once
+// the template fails to load, it's reparsed in full after every edit, until
+// it loads again.
+int hbs_template_apply_edit(HbsTemplate* template, size_t offset,
+    size_t removed_length, const char* inserted, size_t inserted_length)
+{
+    HbsString* source = template->source;
+    if (NULL == source || offset > source->length
+        || removed_length > source->length - offset) {
+        return 1;
+    }
+
+    if (0 != hbs_string_replace(source, offset, removed_length, inserted,
+            inserted_length)) {
+        return 1;
+    }
+
+    int result = template->outdated
+        ? priv_reparse_all(template, source)
+        : priv_reparse_edit(template, source, offset, removed_length,
+            inserted_length);
+    template->outdated = 0 != result;
+    return result;
+}
+
+// Create a template from components which have already been parsed, e.g. by a
+// template set, which splices partials into them first.
+HbsTemplate* hbs_template_from_components(HbsNaryTree* components,
+    const HbsHelperRegistry* helpers, HbsTemplateSet* set)
+{
+    HbsTemplate* template = malloc(sizeof(HbsTemplate));
+    if (NULL == template) {
+        hbs_nary_tree_free(components);
+        return NULL;
+    }
+
+    memset(template, 0, sizeof(HbsTemplate));
+    atomic_init(&template->state, HBS_TEMPLATE_READY);
+    atomic_init(&template->renders, 0);
+    template->components = components;
+    template->helpers = helpers;
+    template->set = set;
+    if (0 != priv_template_compile(template)) {
+        hbs_template_free(template);
+        return NULL;
+    }
+
+    return template;
+}
+
+// Create a template which is parsed from the file at <path> the first time
+// it's rendered. Only the file's metadata is read here.
+HbsTemplate* hbs_template_load_lazy(const char* path) {
+    HbsTemplate* template = malloc(sizeof(HbsTemplate));
+    if (NULL == template) {
+        return NULL;
+    }
+
+    memset(template, 0, sizeof(HbsTemplate));
+    atomic_init(&template->state, HBS_TEMPLATE_UNLOADED);
+    atomic_init(&template->renders, 0);
+    template->path = malloc(strlen(path) + 1);
+    if (NULL == template->path) {
+        free(template);
+        return NULL;
+    }
+
+    strcpy(template->path, path);
+    if (0 != priv_fingerprint_file(path, &template->fingerprint)
+        || 0 != pthread_mutex_init(&template->lock, NULL)) {
+        free(template->path);
         free(template);
         return NULL;
     }
@@ -129,36 +1238,206 @@ HbsTemplate* hbs_template_load(HbsInputContext* input_context) {
     return template;
 }
 
-// Render the template using the template context. The input context contains
-// all context data and helpers (with the exception of the default helpers). If
-// the template contains expressions which don't match up to entries in the
-// context, those expressions are rendered as the empty string "".
-HbsString* hbs_template_render(HbsTemplate* template,
-    HbsHandlers* handlers)
+// Intern the key of an expression, and split it into path segments. This is
+// done once, when the template is loaded, so that renders don't have to.
+int hbs_component_bind(HbsComponent* component, HbsSymbolTable* keys,
+    HbsSymbolTable* segments, const HbsHelperRegistry* helpers)
 {
-    HbsString* result = hbs_string_new();
+    if (HBS_COMPONENT_PARTIAL == component->type) {
+        return priv_bind_partial(component, helpers, keys, segments);
+    }
 
-    HbsNaryTreeIter iterator;
-    hbs_nary_tree_iter_init(&iterator, template->components);
-    HbsNaryNode* element = NULL;
-    HbsNaryNode* root = hbs_nary_tree_get_root(template->components);
+    HbsString* key = hbs_component_key(component);
+    if (NULL == key) {
+        return 1;
+    }
 
-    while (root != (element = hbs_nary_tree_iter_next(&iterator))) {
-        HbsComponent* component = hbs_nary_node_get_data(element);
-        if (0 != priv_render_component(component, result, handlers)) {
-            hbs_string_free(result);
-            return NULL;
+    // Helpers are resolved once, here, so renders don't look them up by name.
+    const HbsHelper* helper = NULL;
+    if (HBS_COMPONENT_EXPRESSION == component->type) {
+        if (NULL != helpers) {
+            helper = hbs_helper_registry_find(helpers, key->string);
+        }
+
+        if (NULL != helper) {
+            component->type = HBS_COMPONENT_HELPER;
+            return priv_bind_call(component, 1, component->argv->length,
+                helper, helpers, keys, segments);
+        } else if (1 != component->argv->length) {
+            return 1;
+        }
+    }
+
+    // Data variables are generated by the library, so they aren't keys.
+    if ('@' == key->string[0]) {
+        return priv_bind_data_variable(component, key->string + 1);
+    }
+
+    component->key_slot = hbs_symbol_table_intern(keys, key->string);
+    if (HBS_SYMBOL_NONE == component->key_slot) {
+        return 1;
+    }
+
+    return priv_split_path(key->string, segments, &component->path);
+}
+
+// Ensure the template is loaded, and prevent it from being evicted until
+// hbs_template_release() is called. Once a lazy template is loaded, this is
+// lock-free. The increment of <renders> must be ordered before the load of
+// <state> (and the opposite way around in hbs_template_evict()), so these
+// use sequentially consistent atomics.
+int hbs_template_acquire(HbsTemplate* template) {
+    if (NULL == template->path) {
+        return 0;
+    }
+
+    atomic_fetch_add(&template->renders, 1);
+    if (HBS_TEMPLATE_READY == atomic_load(&template->state)) {
+        return 0;
+    }
+
+    if (0 != priv_template_load_lazy(template)) {
+        atomic_fetch_sub(&template->renders, 1);
+        return 1;
+    }
+    return 0;
+}
+
+void hbs_template_release(HbsTemplate* template) {
+    if (NULL != template->path) {
+        atomic_fetch_sub(&template->renders, 1);
+    }
+}
+
+// Return a lazy template to the unloaded state, releasing the memory held by
+// its components. It will be parsed again the next time it's rendered.
+int hbs_template_evict(HbsTemplate* template) {
+    if (NULL == template->path) {
+        return 1;
+    }
+
+    int result = 0;
+    pthread_mutex_lock(&template->lock);
+    if (HBS_TEMPLATE_READY == atomic_load(&template->state)) {
+        // New renders now take the slow path, and block on the lock.
+        atomic_store(&template->state, HBS_TEMPLATE_UNLOADED);
+        if (0 == atomic_load(&template->renders)) {
+            priv_template_unload(template);
+        } else {
+            atomic_store(&template->state, HBS_TEMPLATE_READY);
+            result = 1;
         }
     }
 
+    pthread_mutex_unlock(&template->lock);
     return result;
 }
 
+// Load <length> templates from the files at <paths> using a pool of <threads>
+// threads (or one per online CPU, if <threads> is zero). The calling thread
+// takes part in the work, too.
+size_t hbs_template_load_many(const char* const* paths, size_t length,
+    size_t threads, HbsTemplate** templates)
+{
+    HbsLoadQueue queue = {
+        .paths = paths,
+        .templates = templates,
+        .length = length,
+    };
+    atomic_init(&queue.next, 0);
+    atomic_init(&queue.failures, 0);
+
+    if (0 == threads) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (size_t)online : 1;
+    }
+    if (threads > length) {
+        threads = length;
+    }
+
+    pthread_t* workers = NULL;
+    size_t started = 0;
+    if (threads > 1) {
+        workers = calloc(threads - 1, sizeof(pthread_t));
+    }
+
+    // If threads can't be created, the remaining work falls to this thread.
+    for (; NULL != workers && started < threads - 1; ++started) {
+        if (0 != pthread_create(&workers[started], NULL, priv_load_worker,
+                &queue)) {
+            break;
+        }
+    }
+
+    priv_load_worker(&queue);
+    for (size_t i = 0; i < started; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+
+    free(workers);
+    return atomic_load(&queue.failures);
+}
+
+// Return the distinct keys referenced by the template. These are collected
+// when the template is loaded, so this is cheap enough to call per render.
+const char* const* hbs_template_keys(HbsTemplate* template, size_t* length) {
+    *length = 0;
+    if (0 != hbs_template_acquire(template)) {
+        return NULL;
+    }
+
+    // A lazy template may be evicted as soon as it's released, in which case
+    // the keys are gone, too.
+    *length = hbs_symbol_table_length(template->keys);
+    const char* const* keys = hbs_symbol_table_symbols(template->keys);
+    hbs_template_release(template);
+    return keys;
+}
+
+// Return the distinct path segments referenced by the template, which are
+// also collected when the template is loaded.
+const char* const* hbs_template_segments(HbsTemplate* template,
+    size_t* length)
+{
+    *length = 0;
+    if (0 != hbs_template_acquire(template)) {
+        return NULL;
+    }
+
+    *length = hbs_symbol_table_length(template->segments);
+    const char* const* segments = hbs_symbol_table_symbols(
+        template->segments);
+    hbs_template_release(template);
+    return segments;
+}
+
+// Record the parse error of <parser> as the outcome of this thread's load.
+void hbs_template_record_error(const HbsParser* parser) {
+    last_error_located = 0 == hbs_parser_error_location(parser,
+        &last_error.line, &last_error.column);
+}
+
+// Report the location of the parse error of this thread's last load.
+int hbs_template_last_error(HbsParseError* error) {
+    if (!last_error_located) {
+        return 1;
+    }
+
+    *error = last_error;
+    return 0;
+}
+
 // Free the template components, relinquishing all allocated memory back to the
 // system.
 void hbs_template_free(HbsTemplate* template) {
-    if (NULL != template->components) {
-        hbs_nary_tree_free(template->components);
+    priv_template_unload(template);
+    if (NULL != template->source) {
+        hbs_string_free(template->source);
+    }
+
+    if (NULL != template->path) {
+        pthread_mutex_destroy(&template->lock);
+        free(template->path);
     }
 
     free(template);
@@ -8,7 +8,7 @@
 //
 // CREATED:         11/20/2021
 //
-// LAST EDITED:     01/06/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -34,7 +34,9 @@
 #ifndef HANDLEBARS_H
 #define HANDLEBARS_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 // Generic object for getting input to the parser. This struct can be allocated
@@ -46,12 +48,91 @@ typedef struct HbsInputContext {
     void* data;
 } HbsInputContext;
 
+// Generic object for receiving output from a streaming render. As with
+// HbsInputContext, this struct can be allocated on the stack, created by the
+// user, or created using one of the convenience functions provided. <write>
+// returns the number of bytes consumed; anything less than <length> is
+// treated as an error.
+typedef struct HbsOutputContext {
+    size_t (*write)(void* data, const char* buffer, size_t length);
+    void (*free_data)(void* data);
+    void* data;
+} HbsOutputContext;
+
 // Handlers can return these to indicate success or stop rendering
 typedef enum HbsResult {
     HBS_OK,
     HBS_ERROR,
+
+    // Success, but the value may change during the render, so it must not be
+    // memoized (see HbsHandlers.memoize).
+    HBS_VOLATILE,
+
+    // The value isn't available yet. The render is suspended at the current
+    // expression, and can be continued with hbs_render_resume() (which will
+    // invoke the handler again). Handlers must not write any output when
+    // returning this.
+    HBS_PENDING,
+
+    // The render exceeded the limits set in HbsHandlers, and was abandoned.
+    // Returned by the render, not by handlers.
+    HBS_ERROR_BUDGET,
 } HbsResult;
 
+typedef struct HbsString {
+    char* string;
+    size_t length;
+    size_t capacity;
+} HbsString;
+
+// Types of values that can be produced by a value handler.
+typedef enum HbsValueType {
+    HBS_VALUE_NULL,     // Renders as the empty string
+    HBS_VALUE_STRING,   // NUL-terminated string
+    HBS_VALUE_INT,      // Signed 64-bit integer
+    HBS_VALUE_UINT,     // Unsigned 64-bit integer
+    HBS_VALUE_DOUBLE,   // Renders as the shortest string that round-trips
+    HBS_VALUE_BOOL,     // Renders as "true" or "false"
+    HBS_VALUE_OBJECT,   // Context for a block, e.g. "{{#with order}}"
+    HBS_VALUE_ARRAY,    // Elements for "{{#each items}}"
+} HbsValueType;
+
+// A typed value. Numbers are formatted by the library directly into the
+// output, so handlers don't need to convert them to strings first.
+typedef struct HbsValue {
+    HbsValueType type;
+    union {
+        const char* string;
+        int64_t int_value;
+        uint64_t uint_value;
+        double double_value;
+        bool bool_value;
+
+        // Objects and arrays are opaque to the library, which only hands
+        // <pointer> back to the handlers. <length> is the number of elements
+        // of an array. Neither can be rendered directly.
+        struct {
+            const void* pointer;
+            size_t length;
+        } object;
+    };
+} HbsValue;
+
+// A path expression, such as "order.customer.city", split into its segments
+// when the template is loaded. Segments may be separated by "." or "/", and a
+// leading "this" or "./" refers to the current context, so "this.name" and
+// "./name" are both equivalent to "name" (and "this" alone has no segments).
+// Each segment has an id which is unique within the template, so handlers can
+// compare ids rather than strings (see hbs_template_segments()). Each leading
+// "../" refers to the context of the enclosing block, and is counted in
+// <depth>; the library resolves these itself.
+typedef struct HbsPath {
+    const char* const* segments;
+    const size_t* ids;
+    size_t length;
+    size_t depth;
+} HbsPath;
+
 // SAX-style interface for callbacks to render expressions.
 typedef struct HbsHandlers {
     // Key handler. For a plain ol' context substitution expression, for
@@ -62,16 +143,129 @@ typedef struct HbsHandlers {
     HbsResult (*key_handler)(void* key_handler_data, const char* key,
         const char** value);
     void* key_handler_data;
+
+    // Typed alternative to key_handler. If this member is non-NULL, it's
+    // called instead of key_handler, and <value> (which is initialized to
+    // HBS_VALUE_NULL) is formatted according to its type. String values must
+    // remain valid until the handler is called again or the render completes.
+    // Receives key_handler_data as its first argument.
+    HbsResult (*value_handler)(void* key_handler_data, const char* key,
+        HbsValue* value);
+
+    // Streaming alternative to key_handler. If this member is non-NULL, it's
+    // called in preference to value_handler and key_handler, and appends the
+    // value directly to <output> (e.g. using hbs_string_append_*()). This
+    // avoids building a temporary string for values that are computed on the
+    // fly. The handler must only append to <output>. Receives
+    // key_handler_data as its first argument.
+    HbsResult (*write_handler)(void* key_handler_data, const char* key,
+        HbsString* output);
+
+    // Path-aware alternative to value_handler. If this member is non-NULL,
+    // it's called in preference to all the other handlers, with the key
+    // already split into segments, so that the handler can walk its data
+    // without parsing the key on every render. <context> is the value that
+    // <path> is relative to: NULL at the top level of the template, or the
+    // object (or array element) introduced by the enclosing block, e.g.
+    // "{{#with order}}". Otherwise behaves like value_handler. This is the
+    // only handler that can resolve keys within blocks.
+    HbsResult (*path_handler)(void* key_handler_data, const HbsValue* context,
+        const HbsPath* path, HbsValue* value);
+
+    // Required for "{{#each}}". Set <element> to element <index> of <array>,
+    // which was produced by one of the other handlers. Receives
+    // key_handler_data as its first argument.
+    HbsResult (*each_handler)(void* key_handler_data, const HbsValue* array,
+        size_t index, HbsValue* element);
+
+    // Optional. Called once at the start of each render, before any other
+    // handler, with the deduplicated set of keys referenced by the template,
+    // so that they can be fetched in a single batch. <keys> is only valid for
+    // the duration of the call. Receives key_handler_data as its first
+    // argument.
+    HbsResult (*prefetch)(void* key_handler_data, const char* const* keys,
+        size_t length);
+
+    // If true, each distinct key is resolved at most once per render, and
+    // later occurrences of the key reuse the first rendered value. Handlers
+    // can opt individual values out of this by returning HBS_VOLATILE.
+    bool memoize;
+
+    // Optional limits on each render, which fails with HBS_ERROR_BUDGET once
+    // it has produced more than <max_output_length> bytes of output, or has
+    // taken longer than <time_limit> nanoseconds (including any time it spent
+    // suspended). The output produced so far is freed. The clock is only read
+    // every few components, so a render may overrun the time limit by the
+    // time it takes to render them. Zero means no limit.
+    size_t max_output_length;
+    uint64_t time_limit;
 } HbsHandlers;
 
+// A helper, invoked for expressions such as "{{format created "iso"}}". The
+// arguments are resolved (keys through the handlers, and literal strings,
+// numbers, booleans and null as written) and passed in <argv>; strings are
+// only valid for the duration of the call. The helper appends its result to
+// <output>, and may return any of the results a handler can. <data> is the
+// pointer given when the helper was registered.
+typedef HbsResult HbsHelperFn(void* data, size_t argc, const HbsValue* argv,
+    HbsString* output);
+
+// Opaque struct representing a set of named helpers.
+typedef struct HbsHelperRegistry HbsHelperRegistry;
+
+// Flags for hbs_helper_registry_register_with_flags().
+typedef enum HbsHelperFlags {
+    // The helper's output depends only on its arguments, so it may be cached
+    // and reused by any render of any template using the registry. Results
+    // are only cached if the helper returns HBS_OK and none of its arguments
+    // are objects or arrays.
+    HBS_HELPER_PURE = 0x1,
+} HbsHelperFlags;
+
+// Statistics of the cache of pure helper results shared by a registry.
+typedef struct HbsHelperCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t entries;
+    size_t size;        // Bytes used by the entries
+    size_t capacity;    // Maximum value of <size>
+} HbsHelperCacheStats;
+
+// Statistics of the renders of a template, from hbs_template_stats(). Only
+// renders that complete are counted. Times are in nanoseconds, and don't
+// include time that a render spent suspended.
+typedef struct HbsTemplateStats {
+    uint64_t renders;
+    uint64_t render_time;       // Total time of the renders
+    uint64_t max_render_time;   // Time of the longest render
+    uint64_t bytes;             // Total output of the renders
+    uint64_t handler_calls;
+    uint64_t handler_time;      // Time spent in handlers (and prefetch)
+    uint64_t component_size;    // Bytes used by the loaded components,
+    uint64_t string_size;       // the strings they own,
+    uint64_t node_size;         // and the tree holding them
+} HbsTemplateStats;
+
+// Location of a parse error, from hbs_template_last_error().
+typedef struct HbsParseError {
+    size_t line;    // Starting at 1
+    size_t column;  // Starting at 0
+} HbsParseError;
+
 // Opaque struct representing a loaded Handlebars template.
 typedef struct HbsTemplate HbsTemplate;
 
-typedef struct HbsString {
-    char* string;
-    size_t length;
-    size_t capacity;
-} HbsString;
+// Opaque struct representing an in-progress render of a template.
+typedef struct HbsRender HbsRender;
+
+// Opaque struct representing a set of named templates, which can include
+// each other as partials.
+typedef struct HbsTemplateSet HbsTemplateSet;
+
+// Opaque struct recording where the value of each expression was written in
+// the output of a render.
+typedef struct HbsSpanMap HbsSpanMap;
 
 // Initialize a string
 HbsString* hbs_string_new();
@@ -83,9 +277,50 @@ HbsString* hbs_string_from_str(const char* string);
 int hbs_string_append(HbsString* first, const HbsString* second);
 int hbs_string_append_str(HbsString* first, const char* second);
 
+// Append <length> chars from <buffer>, which need not be NUL-terminated.
+int hbs_string_append_buffer(HbsString* first, const char* buffer,
+    size_t length);
+
+// Make room for <length> chars in <string>, plus its terminator.
+int hbs_string_reserve(HbsString* string, size_t length);
+
+// Replace <removed> chars of <string> at <offset> with <length> chars from
+// <buffer>, in place.
+int hbs_string_replace(HbsString* string, size_t offset, size_t removed,
+    const char* buffer, size_t length);
+
+// Append the string representation of <value>. Integers, doubles and booleans
+// are formatted without going through printf, so the result does not depend
+// on the current locale.
+int hbs_string_append_value(HbsString* string, const HbsValue* value);
+
 // Free all memory associated with a string
 void hbs_string_free(HbsString* string);
 
+// Create an empty helper registry
+HbsHelperRegistry* hbs_helper_registry_new();
+
+// Register <function> as the helper <name>, which receives <data> as its
+// first argument. Returns non-zero on failure.
+int hbs_helper_registry_register(HbsHelperRegistry* registry,
+    const char* name, HbsHelperFn* function, void* data);
+
+// As hbs_helper_registry_register(), with a bitwise OR of HbsHelperFlags.
+int hbs_helper_registry_register_with_flags(HbsHelperRegistry* registry,
+    const char* name, HbsHelperFn* function, void* data, unsigned flags);
+
+// Set the maximum number of bytes used to cache the results of pure helpers
+// (1 MiB by default). Zero disables the cache. The cache is thread-safe.
+void hbs_helper_registry_set_cache_capacity(HbsHelperRegistry* registry,
+    size_t capacity);
+
+// Retrieve the statistics of the registry's cache.
+void hbs_helper_registry_cache_stats(HbsHelperRegistry* registry,
+    HbsHelperCacheStats* stats);
+
+// Free the registry. Templates loaded with it must be freed first.
+void hbs_helper_registry_free(HbsHelperRegistry* registry);
+
 // Create an input context from the file with the given path
 HbsInputContext* hbs_input_context_from_file(const char* filename);
 
@@ -96,15 +331,233 @@ HbsInputContext* hbs_input_context_from_string(const char* string);
 // using library convenience functions)
 void hbs_input_context_free(HbsInputContext* input_context);
 
+// Create an output context which appends to <string>. The string is not
+// owned by the output context.
+HbsOutputContext* hbs_output_context_from_string(HbsString* string);
+
+// Free the output context (only necessary for HbsOutputContext instances
+// created using library convenience functions)
+void hbs_output_context_free(HbsOutputContext* output_context);
+
+// Render a template directly from <input_context> to <output_context> in a
+// single pass, without loading it first. Text and values are written to the
+// output as the input is scanned, so memory usage does not depend on the size
+// of the template. This is intended for templates which are rendered only
+// once. Since the keys are not known in advance, the prefetch handler is not
+// called and memoization is not supported. Nor are blocks, which may need to
+// be rendered more than once. Returns HBS_OK on success, HBS_ERROR_BUDGET if
+// the render exceeds the limits in <handlers>, or HBS_ERROR if the template
+// is malformed, a handler fails (or is pending) or the output context fails.
+HbsResult hbs_render_stream(HbsInputContext* input_context,
+    HbsHandlers* handlers, HbsOutputContext* output_context);
+
 // Load the template from the input context. After this, the input context
-// can be freed (if necessary).
+// can be freed (if necessary). Templates may contain the blocks
+// "{{#with key}}...{{/with}}", which renders its contents in the context of
+// <key> (or not at all if <key> is null or false), and
+// "{{#each key}}...{{/each}}", which renders its contents once for each
+// element of an array. Blocks may be nested up to 32 deep.
 HbsTemplate* hbs_template_load(HbsInputContext* input_context);
 
+// Like hbs_template_load(), but expressions whose first word is the name of a
+// helper in <registry> invoke that helper. Helpers are looked up once, when
+// the template is loaded, so they must be registered beforehand, and the
+// registry must outlive the template. An expression with more than one word
+// that does not name a helper is an error.
+HbsTemplate* hbs_template_load_with_helpers(HbsInputContext* input_context,
+    const HbsHelperRegistry* registry);
+
+// Create an empty template set. Templates in the set may call the helpers in
+// <registry> (which may be NULL), which must outlive the set.
+HbsTemplateSet* hbs_template_set_new(const HbsHelperRegistry* registry);
+
+// Parse the template <name> from <input_context> and add it to the set, or
+// replace the template of that name. It can't be rendered until the set is
+// linked. Returns non-zero (and leaves the set unchanged) if the template
+// can't be parsed.
+int hbs_template_set_add(HbsTemplateSet* set, const char* name,
+    HbsInputContext* input_context);
+
+// Link the templates which have been added or replaced since the set was
+// last linked, and those which include them as partials (directly or not).
+// Partials with static names are inlined, so "{{> header}}" costs nothing at
+// render time, and "{{> header key}}" is rendered like
+// "{{#with key}}{{> header}}{{/with}}". Partials whose names are computed by
+// a helper (e.g. "{{> (concat 'card-' type)}}") are looked up by name when
+// rendered, in the top level context. Returns the number of templates which
+// failed to link, e.g. because of a missing or recursive partial. A template
+// which fails to link keeps its previous version, if there is one. Partials
+// are inlined from the source of a template, so a partial that can't be
+// rendered on its own (e.g. it refers to "../key") can still be included.
+//
+// Layouts are flattened the same way. A partial block
+// ("{{#> layout}}...{{/layout}}") inlines the layout, in which
+// "{{> @partial-block}}" is the body of the block, and the inline partials
+// the body defines ("{{#*inline "title"}}...{{/inline}}") replace the
+// partials of the same name. A partial block naming a partial that doesn't
+// exist is replaced by its body, which makes it a placeholder with default
+// content ("{{#> title}}Untitled{{/title}}"). The text around the inlined
+// partials is merged, so a page costs the same to render as if it were
+// written out by hand.
+size_t hbs_template_set_link(HbsTemplateSet* set);
+
+// Return the linked template <name>, or NULL if there isn't one. The template
+// is owned by the set, and remains valid until it's relinked or the set is
+// freed.
+HbsTemplate* hbs_template_set_get(HbsTemplateSet* set, const char* name);
+
+// Free the set and all of its templates.
+void hbs_template_set_free(HbsTemplateSet* set);
+
+// Load a template like hbs_template_load_with_helpers(), keeping a copy of
+// its source so that it can be edited with hbs_template_apply_edit().
+HbsTemplate* hbs_template_load_editable(HbsInputContext* input_context,
+    const HbsHelperRegistry* registry);
+
+// Replace <removed_length> bytes of the source of the editable <template>,
+// starting at <offset>, with <inserted_length> bytes from <inserted>, and
+// update the template to match. Only the expressions around the edit are
+// parsed again, and only the blocks enclosing it are paired again (unless it
+// changes which blocks the rest of the template opens and closes), so the
+// cost follows the size of the edit rather than the size of the template.
+// Keys which are no longer used remain in hbs_template_keys(), and span maps
+// of earlier renders are invalidated. Returns non-zero if the edited template
+// doesn't load (e.g. a block hasn't been closed yet), in which case the edit
+// is still applied to the source, and renders use the last version that
+// loaded until a later edit fixes it. The template must not be rendered
+// while it's being edited.
+int hbs_template_apply_edit(HbsTemplate* template, size_t offset,
+    size_t removed_length, const char* inserted, size_t inserted_length);
+
+// Create a template from the file at <path> without reading its contents.
+// The file is parsed (once, even if rendered from several threads) the first
+// time the template is rendered, so that rarely-used templates cost little
+// at startup. The size and modification time of the file are recorded here,
+// and the template fails to load (so renders of it fail) if the file has
+// changed by the time it's parsed, including after it's been evicted. Create
+// a new template to pick up the changes. Returns NULL if the file does not
+// exist.
+HbsTemplate* hbs_template_load_lazy(const char* path);
+
+// Return a lazy template to its unparsed state, to release memory when it's
+// not in use. It will be parsed again the next time it is rendered. Returns
+// non-zero (and does nothing) if the template is not lazy, or if a render of
+// the template is in progress.
+int hbs_template_evict(HbsTemplate* template);
+
+// Load many templates in parallel, e.g. at startup. Template <i> is loaded
+// from the file at paths[i] and stored in templates[i], which is set to NULL
+// if the file could not be read or parsed. The work is spread over <threads>
+// threads (zero means one per online CPU). Returns the number of templates
+// that failed to load.
+size_t hbs_template_load_many(const char* const* paths, size_t length,
+    size_t threads, HbsTemplate** templates);
+
 // Render the template. <handlers> is used to obtain data ("context") for
 // rendering the template. The output is an HbsString object which must be
-// free'd using hbs_string_free() after use to prevent memory leaks.
+// free'd using hbs_string_free() after use to prevent memory leaks. Returns
+// NULL if a handler returns HBS_PENDING; use hbs_render_new() for that.
 HbsString* hbs_template_render(HbsTemplate* template, HbsHandlers* handlers);
 
+// Render the template like hbs_template_render(), and also create a span map
+// in <span_map>, recording where the values of the expressions are in the
+// output, for hbs_template_rerender(). The span map must be free'd using
+// hbs_span_map_free().
+HbsString* hbs_template_render_spans(HbsTemplate* template,
+    HbsHandlers* handlers, HbsSpanMap** span_map);
+
+// Update <output>, which was produced by hbs_template_render_spans() (or a
+// previous call to this function) along with <span_map>, after the values of
+// the keys in <changed> have changed. Keys are identified by their index in
+// hbs_template_keys(). Only the changed values are resolved and rewritten,
+// in place, and the output after them is moved once if their lengths change,
+// so the cost follows the size of the change and the bytes after it rather
+// than the size of the output. If a changed key can
+// affect more than its own values (e.g. it's the key of a block, the argument
+// of a helper, or relative to the context of a block), or the template
+// renders partials by computed names, the template is rendered again
+// instead. Returns non-zero (leaving <output> unchanged) if a handler fails.
+int hbs_template_rerender(HbsTemplate* template, HbsHandlers* handlers,
+    HbsString* output, HbsSpanMap* span_map, const size_t* changed,
+    size_t length);
+
+void hbs_span_map_free(HbsSpanMap* span_map);
+
+// Create a copy of <template> in which the values of constant keys (e.g. the
+// name of the site) are folded into the surrounding text, so that rendering
+// it only resolves the remaining keys, and copies fewer segments. Each key
+// relative to the top level of the template is resolved once through
+// <handlers>, which return HBS_OK for constant values and HBS_VOLATILE for
+// keys that must still be resolved at render time. Returns NULL if a handler
+// fails (or returns HBS_PENDING). The new template is independent of
+// <template>, and must be free'd using hbs_template_free().
+HbsTemplate* hbs_template_specialize(HbsTemplate* template,
+    HbsHandlers* handlers);
+
+// Prepare to render <template>, without rendering anything yet. <template>
+// and <handlers> must outlive the render, which must be free'd using
+// hbs_render_free().
+HbsRender* hbs_render_new(HbsTemplate* template, HbsHandlers* handlers);
+
+// Render until the template is complete (HBS_OK), until a handler returns
+// HBS_PENDING (HBS_PENDING), or until an error occurs (HBS_ERROR, or
+// HBS_ERROR_BUDGET if the render exceeds the limits in its handlers). A render
+// that is pending keeps its position, so that a single thread can interleave
+// many renders, calling this function again once the value is available.
+HbsResult hbs_render_resume(HbsRender* render);
+
+// Generator-style alternative to hbs_render_resume(), for writing output to
+// a socket (for example) without buffering all of it. Renders at most
+// <capacity> bytes into <buffer>, setting <written> to the number of bytes
+// produced. Output may stop partway through a text component or value, and
+// continues from there on the next call. Returns HBS_OK with <written> set
+// to zero once the render is complete. Errors and HBS_PENDING are
+// returned as for hbs_render_resume(), but <written> bytes are still valid.
+// A render must be driven either by this function or by hbs_render_resume(),
+// not both.
+HbsResult hbs_render_step(HbsRender* render, char* buffer, size_t capacity,
+    size_t* written);
+
+// Take ownership of the output of a render. The output is complete once
+// hbs_render_resume() has returned HBS_OK. The caller must free the result
+// using hbs_string_free().
+HbsString* hbs_render_take_output(HbsRender* render);
+
+// Free the render, and its output if it has not been taken.
+void hbs_render_free(HbsRender* render);
+
+// Return the deduplicated set of keys referenced by the template, in order of
+// first appearance, and store its length in <length>. The array is owned by
+// the template (and, for lazy templates, is only valid until it's evicted).
+// Returns NULL if a lazy template could not be loaded.
+const char* const* hbs_template_keys(HbsTemplate* template, size_t* length);
+
+// Return the distinct path segments referenced by the template, indexed by the
+// ids in HbsPath, and store the length in <length>. Handlers can use this to
+// map segments to their own data once per template, rather than once per
+// render. Ownership and lifetime are as for hbs_template_keys().
+const char* const* hbs_template_segments(HbsTemplate* template,
+    size_t* length);
+
+// Retrieve the statistics of <template>, which are updated by every render
+// without taking any locks. Returns non-zero if the library was built without
+// statistics (with HBS_DISABLE_STATS defined), in which case they're zero.
+int hbs_template_stats(HbsTemplate* template, HbsTemplateStats* stats);
+
+// Append the statistics in <stats> to <output> in the Prometheus text
+// exposition format, with each element labelled by the corresponding entry of
+// <names> (e.g. template="index.hbs"). Times are converted to seconds.
+int hbs_template_stats_prometheus(HbsString* output,
+    const char* const* names, const HbsTemplateStats* stats, size_t length);
+
+// Retrieve the location of the syntax error that caused the most recent
+// template load in the calling thread to fail. This includes the
+// hbs_template_load*() functions, hbs_template_set_add(), and the first
+// render of a lazy template. Returns non-zero if that load didn't fail
+// because of a syntax error (e.g. it succeeded, or a block wasn't closed),
+// or the error couldn't be located.
+int hbs_template_last_error(HbsParseError* error);
+
 // Free the template
 void hbs_template_free(HbsTemplate* template);
 
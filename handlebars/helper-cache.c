@@ -0,0 +1,294 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            helper-cache.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of the helper result cache.
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+////
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <handlebars/handlebars.h>
+#include <handlebars/helper-cache.h>
+#include <handlebars/symbol-table.h>
+
+static const size_t DEFAULT_BUCKET_COUNT = 16;
+
+// An entry is allocated in one piece, with the key and then the value stored
+// after the header.
+typedef struct HbsCacheEntry {
+    struct HbsCacheEntry* next;     // Next entry in the same bucket
+    struct HbsCacheEntry* newer;    // Neighbours in order of use
+    struct HbsCacheEntry* older;
+    uint64_t hash;
+    size_t key_length;
+    size_t value_length;
+    char data[];
+} HbsCacheEntry;
+
+typedef struct HbsHelperCache {
+    // Taken by every operation, since even lookups reorder the entries. The
+    // helpers themselves are called without holding it.
+    pthread_mutex_t lock;
+
+    // Hash table with separate chaining. The number of buckets is always a
+    // power of two, and is grown to keep the chains short.
+    HbsCacheEntry** buckets;
+    size_t bucket_count;
+
+    // Entries, from the most to the least recently used.
+    HbsCacheEntry* newest;
+    HbsCacheEntry* oldest;
+
+    size_t size;
+    size_t capacity;
+    size_t entries;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} HbsHelperCache;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static inline size_t priv_entry_size(const HbsCacheEntry* entry)
+{ return sizeof(HbsCacheEntry) + entry->key_length + entry->value_length; }
+
+// Return the link which points to the entry for <key>, or the NULL link at the
+// end of its bucket if there isn't one.
+static HbsCacheEntry** priv_find_link(HbsHelperCache* cache, uint64_t hash,
+    const char* key, size_t key_length)
+{
+    HbsCacheEntry** link = &cache->buckets[hash & (cache->bucket_count - 1)];
+    while (NULL != *link) {
+        const HbsCacheEntry* entry = *link;
+        if (hash == entry->hash && key_length == entry->key_length
+            && 0 == memcmp(key, entry->data, key_length)) {
+            break;
+        }
+        link = &(*link)->next;
+    }
+
+    return link;
+}
+
+static void priv_unlink_use(HbsHelperCache* cache, HbsCacheEntry* entry) {
+    if (NULL != entry->newer) {
+        entry->newer->older = entry->older;
+    } else {
+        cache->newest = entry->older;
+    }
+
+    if (NULL != entry->older) {
+        entry->older->newer = entry->newer;
+    } else {
+        cache->oldest = entry->newer;
+    }
+}
+
+static void priv_mark_newest(HbsHelperCache* cache, HbsCacheEntry* entry) {
+    entry->newer = NULL;
+    entry->older = cache->newest;
+    if (NULL != cache->newest) {
+        cache->newest->newer = entry;
+    } else {
+        cache->oldest = entry;
+    }
+    cache->newest = entry;
+}
+
+// Remove the entry which <link> points to.
+static void priv_remove(HbsHelperCache* cache, HbsCacheEntry** link) {
+    HbsCacheEntry* entry = *link;
+    *link = entry->next;
+    priv_unlink_use(cache, entry);
+    cache->size -= priv_entry_size(entry);
+    cache->entries -= 1;
+    free(entry);
+}
+
+static void priv_evict_oldest(HbsHelperCache* cache) {
+    HbsCacheEntry* entry = cache->oldest;
+    priv_remove(cache, priv_find_link(cache, entry->hash, entry->data,
+            entry->key_length));
+    cache->evictions += 1;
+}
+
+// Double the number of buckets. If memory can't be allocated, the chains are
+// just left to grow longer.
+static void priv_grow(HbsHelperCache* cache) {
+    const size_t bucket_count = 2 * cache->bucket_count;
+    HbsCacheEntry** buckets = calloc(bucket_count, sizeof(HbsCacheEntry*));
+    if (NULL == buckets) {
+        return;
+    }
+
+    for (size_t i = 0; i < cache->bucket_count; ++i) {
+        HbsCacheEntry* entry = cache->buckets[i];
+        while (NULL != entry) {
+            HbsCacheEntry* next = entry->next;
+            HbsCacheEntry** bucket = &buckets[entry->hash & (bucket_count - 1)];
+            entry->next = *bucket;
+            *bucket = entry;
+            entry = next;
+        }
+    }
+
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucket_count = bucket_count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+HbsHelperCache* hbs_helper_cache_new(size_t capacity) {
+    HbsHelperCache* cache = malloc(sizeof(HbsHelperCache));
+    if (NULL == cache) {
+        return NULL;
+    }
+
+    memset(cache, 0, sizeof(HbsHelperCache));
+    cache->buckets = calloc(DEFAULT_BUCKET_COUNT, sizeof(HbsCacheEntry*));
+    if (NULL == cache->buckets || 0 != pthread_mutex_init(&cache->lock, NULL))
+    {
+        free(cache->buckets);
+        free(cache);
+        return NULL;
+    }
+
+    cache->bucket_count = DEFAULT_BUCKET_COUNT;
+    cache->capacity = capacity;
+    return cache;
+}
+
+void hbs_helper_cache_resize(HbsHelperCache* cache, size_t capacity) {
+    pthread_mutex_lock(&cache->lock);
+    cache->capacity = capacity;
+    while (cache->size > cache->capacity) {
+        priv_evict_oldest(cache);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+int hbs_helper_cache_lookup(HbsHelperCache* cache, const char* key,
+    size_t key_length, HbsString* output)
+{
+    const uint64_t hash = hbs_hash_bytes(key, key_length);
+    int result = 1;
+    pthread_mutex_lock(&cache->lock);
+    HbsCacheEntry* entry = *priv_find_link(cache, hash, key, key_length);
+    if (NULL != entry && 0 == hbs_string_append_buffer(output,
+            entry->data + key_length, entry->value_length)) {
+        priv_unlink_use(cache, entry);
+        priv_mark_newest(cache, entry);
+        cache->hits += 1;
+        result = 0;
+    } else {
+        cache->misses += 1;
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+    return result;
+}
+
+void hbs_helper_cache_insert(HbsHelperCache* cache, const char* key,
+    size_t key_length, const char* value, size_t value_length)
+{
+    const uint64_t hash = hbs_hash_bytes(key, key_length);
+    const size_t size = sizeof(HbsCacheEntry) + key_length + value_length;
+    HbsCacheEntry* entry = malloc(size);
+    if (NULL == entry) {
+        return;
+    }
+
+    entry->hash = hash;
+    entry->key_length = key_length;
+    entry->value_length = value_length;
+    memcpy(entry->data, key, key_length);
+    memcpy(entry->data + key_length, value, value_length);
+
+    pthread_mutex_lock(&cache->lock);
+    if (size > cache->capacity) {
+        pthread_mutex_unlock(&cache->lock);
+        free(entry);
+        return;
+    }
+
+    // Another render may have computed the same value in the meantime.
+    HbsCacheEntry** link = priv_find_link(cache, hash, key, key_length);
+    if (NULL != *link) {
+        priv_remove(cache, link);
+    }
+
+    while (cache->size + size > cache->capacity) {
+        priv_evict_oldest(cache);
+    }
+
+    if (cache->entries >= cache->bucket_count) {
+        priv_grow(cache);
+    }
+
+    HbsCacheEntry** bucket = &cache->buckets[hash & (cache->bucket_count - 1)];
+    entry->next = *bucket;
+    *bucket = entry;
+    priv_mark_newest(cache, entry);
+    cache->size += size;
+    cache->entries += 1;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void hbs_helper_cache_stats(HbsHelperCache* cache, HbsHelperCacheStats* stats)
+{
+    pthread_mutex_lock(&cache->lock);
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->entries = cache->entries;
+    stats->size = cache->size;
+    stats->capacity = cache->capacity;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void hbs_helper_cache_free(HbsHelperCache* cache) {
+    HbsCacheEntry* entry = cache->newest;
+    while (NULL != entry) {
+        HbsCacheEntry* older = entry->older;
+        free(entry);
+        entry = older;
+    }
+
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->buckets);
+    free(cache);
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            helper-cache.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Thread-safe LRU cache of the results of pure helpers.
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+////
+
+#ifndef HANDLEBARS_HELPER_CACHE_H
+#define HANDLEBARS_HELPER_CACHE_H
+
+#include <stddef.h>
+
+typedef struct HbsHelperCacheStats HbsHelperCacheStats;
+typedef struct HbsString HbsString;
+
+// Opaque typedef for the cache. Keys and values are arbitrary bytes.
+typedef struct HbsHelperCache HbsHelperCache;
+
+// Create a cache holding at most <capacity> bytes of entries (keys, values
+// and the bookkeeping for each).
+HbsHelperCache* hbs_helper_cache_new(size_t capacity);
+
+// Change the capacity of the cache, evicting entries as necessary. A capacity
+// of zero disables the cache.
+void hbs_helper_cache_resize(HbsHelperCache* cache, size_t capacity);
+
+// If <key> is in the cache, append its value to <output>, mark it as recently
+// used, and return zero. Otherwise, return non-zero.
+int hbs_helper_cache_lookup(HbsHelperCache* cache, const char* key,
+    size_t key_length, HbsString* output);
+
+// Insert <value> for <key>, evicting the least recently used entries to make
+// room. Values that would not fit in the cache are not inserted. Failure to
+// insert is not an error, so this doesn't return anything.
+void hbs_helper_cache_insert(HbsHelperCache* cache, const char* key,
+    size_t key_length, const char* value, size_t value_length);
+
+void hbs_helper_cache_stats(HbsHelperCache* cache, HbsHelperCacheStats* stats);
+
+void hbs_helper_cache_free(HbsHelperCache* cache);
+
+#endif // HANDLEBARS_HELPER_CACHE_H
+
+///////////////////////////////////////////////////////////////////////////////
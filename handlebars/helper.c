@@ -0,0 +1,210 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            helper.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of the helper registry.
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+////
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <handlebars/handlebars.h>
+#include <handlebars/helper-cache.h>
+#include <handlebars/helper.h>
+#include <handlebars/symbol-table.h>
+#include <handlebars/vector.h>
+
+typedef struct HbsHelperRegistry {
+    // Names of the helpers, and the helpers themselves, indexed by the id of
+    // the name.
+    HbsSymbolTable* names;
+    HbsVector* helpers;
+
+    // Results of pure helpers, shared by every template using the registry,
+    // and the id of the next helper to be registered.
+    HbsHelperCache* cache;
+    size_t next_id;
+} HbsHelperRegistry;
+
+static const size_t DEFAULT_CACHE_CAPACITY = 1 << 20;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static inline int priv_append_bytes(HbsString* key, const void* data,
+    size_t length)
+{ return hbs_string_append_buffer(key, (const char*)data, length); }
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+HbsHelperRegistry* hbs_helper_registry_new() {
+    HbsHelperRegistry* registry = malloc(sizeof(HbsHelperRegistry));
+    if (NULL == registry) {
+        return NULL;
+    }
+
+    registry->names = hbs_symbol_table_new();
+    registry->helpers = hbs_vector_new();
+    registry->cache = hbs_helper_cache_new(DEFAULT_CACHE_CAPACITY);
+    registry->next_id = 0;
+    if (NULL == registry->names || NULL == registry->helpers
+        || NULL == registry->cache) {
+        hbs_helper_registry_free(registry);
+        return NULL;
+    }
+
+    return registry;
+}
+
+int hbs_helper_registry_register(HbsHelperRegistry* registry,
+    const char* name, HbsHelperFn* function, void* data)
+{
+    return hbs_helper_registry_register_with_flags(registry, name, function,
+        data, 0);
+}
+
+// Register <function> as the helper <name>. Registering a name again updates
+// the existing entry in place, including for templates already bound to it,
+// and gives it a new id, so the results cached for the old function are left
+// to be evicted.
+int hbs_helper_registry_register_with_flags(HbsHelperRegistry* registry,
+    const char* name, HbsHelperFn* function, void* data, unsigned flags)
+{
+    const size_t length = hbs_symbol_table_length(registry->names);
+    const size_t id = hbs_symbol_table_intern(registry->names, name);
+    if (HBS_SYMBOL_NONE == id) {
+        return 1;
+    }
+
+    if (id < length) {
+        HbsHelper* helper = registry->helpers->vector[id];
+        helper->function = function;
+        helper->data = data;
+        helper->flags = flags;
+        helper->id = registry->next_id++;
+        return 0;
+    }
+
+    HbsHelper* helper = malloc(sizeof(HbsHelper));
+    if (NULL == helper) {
+        return 1;
+    }
+
+    helper->function = function;
+    helper->data = data;
+    helper->flags = flags;
+    helper->id = registry->next_id++;
+    helper->cache = registry->cache;
+    if (0 != hbs_vector_push_back(registry->helpers, helper)) {
+        free(helper);
+        return 1;
+    }
+    return 0;
+}
+
+// Return the helper registered as <name>, or NULL if there isn't one.
+const HbsHelper* hbs_helper_registry_find(const HbsHelperRegistry* registry,
+    const char* name)
+{
+    const size_t id = hbs_symbol_table_find(registry->names, name);
+    if (HBS_SYMBOL_NONE == id) {
+        return NULL;
+    }
+
+    return registry->helpers->vector[id];
+}
+
+// The key is the id of the helper followed by each argument's type and value.
+// Strings are prefixed with their length, so the key is unambiguous.
+int hbs_helper_cache_key(const HbsHelper* helper, size_t argc,
+    const HbsValue* argv, HbsString* key)
+{
+    int result = priv_append_bytes(key, &helper->id, sizeof(helper->id));
+    for (size_t i = 0; i < argc && 0 == result; ++i) {
+        const HbsValue* value = &argv[i];
+        const unsigned char type = value->type;
+        result = priv_append_bytes(key, &type, sizeof(type));
+        switch (value->type) {
+        case HBS_VALUE_NULL: break;
+        case HBS_VALUE_STRING: {
+            // A NULL string has a length which no real string can have.
+            const size_t length = NULL != value->string
+                ? strlen(value->string) : SIZE_MAX;
+            result |= priv_append_bytes(key, &length, sizeof(length));
+            if (NULL != value->string) {
+                result |= priv_append_bytes(key, value->string, length);
+            }
+            break;
+        }
+        case HBS_VALUE_INT:
+        case HBS_VALUE_UINT:
+            result |= priv_append_bytes(key, &value->uint_value,
+                sizeof(value->uint_value));
+            break;
+        case HBS_VALUE_DOUBLE:
+            result |= priv_append_bytes(key, &value->double_value,
+                sizeof(value->double_value));
+            break;
+        case HBS_VALUE_BOOL:
+            result |= priv_append_bytes(key, &value->bool_value,
+                sizeof(value->bool_value));
+            break;
+        default:
+            return 1;
+        }
+    }
+
+    return result;
+}
+
+void hbs_helper_registry_set_cache_capacity(HbsHelperRegistry* registry,
+    size_t capacity)
+{ hbs_helper_cache_resize(registry->cache, capacity); }
+
+void hbs_helper_registry_cache_stats(HbsHelperRegistry* registry,
+    HbsHelperCacheStats* stats)
+{ hbs_helper_cache_stats(registry->cache, stats); }
+
+void hbs_helper_registry_free(HbsHelperRegistry* registry) {
+    if (NULL != registry->names) {
+        hbs_symbol_table_free(registry->names);
+    }
+
+    if (NULL != registry->helpers) {
+        hbs_vector_free(registry->helpers, free);
+    }
+
+    if (NULL != registry->cache) {
+        hbs_helper_cache_free(registry->cache);
+    }
+    free(registry);
+}
+
+///////////////////////////////////////////////////////////////////////////////
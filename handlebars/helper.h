@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            helper.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Registry of helpers, bound to templates at load time.
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+////
+
+#ifndef HANDLEBARS_HELPER_H
+#define HANDLEBARS_HELPER_H
+
+#include <handlebars/handlebars.h>
+
+typedef struct HbsHelperCache HbsHelperCache;
+
+// A registered helper. Entries are allocated individually, so pointers to
+// them remain valid as more helpers are registered.
+typedef struct HbsHelper {
+    HbsHelperFn* function;
+    void* data;
+    unsigned flags;
+
+    // Id of the helper in the keys of the registry's cache of pure helper
+    // results, and the cache itself. The id changes whenever the helper is
+    // registered again, so that results of the old function aren't reused.
+    size_t id;
+    HbsHelperCache* cache;
+} HbsHelper;
+
+// Return the helper registered as <name>, or NULL if there isn't one.
+const HbsHelper* hbs_helper_registry_find(const HbsHelperRegistry* registry,
+    const char* name);
+
+// Serialize a call of <helper> with <argv> into <key>, for its cache. Returns
+// non-zero if the call can't be cached, because an argument is an object or
+// an array (which are opaque to the library).
+int hbs_helper_cache_key(const HbsHelper* helper, size_t argc,
+    const HbsValue* argv, HbsString* key);
+
+#endif // HANDLEBARS_HELPER_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,7 @@
 //
 // CREATED:         11/21/2021
 //
-// LAST EDITED:     01/06/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -30,6 +30,7 @@
 // IN THE SOFTWARE.
 ////
 
+#include <stdio.h>
 #include <string.h>
 
 #include <handlebars/handlebars.h>
@@ -50,21 +51,43 @@ size_t hbs_priv_read_string(void* data, char* buffer, size_t buffer_size)
         return 0;
     }
 
-    size_t string_length = strlen(input->string);
+    size_t string_length = strlen(input->string + input->position);
     if (string_length > buffer_size) {
         string_length = buffer_size;
     }
 
-    strncpy(buffer, input->string + input->position, string_length);
+    memcpy(buffer, input->string + input->position, string_length);
     input->position += string_length;
     return string_length;
 }
 
+size_t hbs_priv_read_file(void* data, char* buffer, size_t buffer_size)
+{ return fread(buffer, 1, buffer_size, (FILE*)data); }
+
+void hbs_priv_close_file(void* data)
+{ fclose((FILE*)data); }
+
 ///////////////////////////////////////////////////////////////////////////////
 // Public API
 ////
 
-HbsInputContext* hbs_input_context_from_file(const char* filename);
+HbsInputContext* hbs_input_context_from_file(const char* filename) {
+    HbsInputContext* context = malloc(sizeof(HbsInputContext));
+    if (NULL == context) {
+        return NULL;
+    }
+
+    FILE* file = fopen(filename, "rb");
+    if (NULL == file) {
+        free(context);
+        return NULL;
+    }
+
+    context->data = file;
+    context->free_data = hbs_priv_close_file;
+    context->read = hbs_priv_read_file;
+    return context;
+}
 
 HbsInputContext* hbs_input_context_from_string(const char* string) {
     HbsInputContext* context = malloc(sizeof(HbsInputContext));
@@ -7,7 +7,7 @@
 //
 // CREATED:         12/17/2021
 //
-// LAST EDITED:     01/06/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -47,6 +47,26 @@ typedef struct HbsNaryTree {
     HbsVector* nodes;
 } HbsNaryTree;
 
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+// Ensure that <vector> can hold <length> elements without reallocating.
+static int priv_reserve(HbsVector* vector, size_t length) {
+    if (vector->capacity >= length) {
+        return 0;
+    }
+
+    void** elements = realloc(vector->vector, length * sizeof(void*));
+    if (NULL == elements) {
+        return 1;
+    }
+
+    vector->vector = elements;
+    vector->capacity = length;
+    return 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Public API
 ////
@@ -94,6 +114,65 @@ int hbs_nary_tree_append_child_to_node(HbsNaryTree* tree, HbsNaryNode* parent,
     return 0;
 }
 
+size_t hbs_nary_tree_length(HbsNaryTree* tree)
+{ return tree->nodes->length; }
+
+HbsNaryNode* hbs_nary_tree_node_at(HbsNaryTree* tree, size_t index)
+{ return tree->nodes->vector[index]; }
+
+size_t hbs_nary_tree_size(HbsNaryTree* tree) {
+    return sizeof(HbsNaryTree) + sizeof(HbsVector)
+        + tree->nodes->capacity * sizeof(void*)
+        + tree->nodes->length * sizeof(HbsNaryNode);
+}
+
+// Nodes are exchanged in place, and the vectors only grow (never shrink), so
+// undoing a splice never needs to allocate, and can't fail.
+int hbs_nary_tree_splice(HbsNaryTree* tree, size_t position, size_t removed,
+    HbsNaryTree* other)
+{
+    HbsVector* nodes = tree->nodes;
+    HbsVector* others = other->nodes;
+    const size_t inserted = others->length - 1;
+    if (0 != priv_reserve(nodes, nodes->length - removed + inserted)
+        || 0 != priv_reserve(others, removed + 1)) {
+        return 1;
+    }
+
+    void** here = nodes->vector + position;
+    void** there = others->vector;
+    const size_t common = removed < inserted ? removed : inserted;
+    for (size_t i = 0; i < common; ++i) {
+        void* node = here[i];
+        here[i] = there[i];
+        there[i] = node;
+    }
+
+    // Move the rest, keeping the roots at the end of their trees.
+    const size_t after = nodes->length - position - removed;
+    if (inserted > removed) {
+        memmove(here + inserted, here + removed, after * sizeof(void*));
+        memcpy(here + removed, there + removed,
+            (inserted - removed) * sizeof(void*));
+        there[removed] = there[inserted];
+    } else {
+        there[removed] = there[inserted];
+        memcpy(there + inserted, here + inserted,
+            (removed - inserted) * sizeof(void*));
+        memmove(here + inserted, here + removed, after * sizeof(void*));
+    }
+
+    nodes->length = nodes->length - removed + inserted;
+    others->length = removed + 1;
+    for (size_t i = 0; i < inserted; ++i) {
+        ((HbsNaryNode*)here[i])->parent = nodes->vector[nodes->length - 1];
+    }
+    for (size_t i = 0; i < removed; ++i) {
+        ((HbsNaryNode*)there[i])->parent = there[removed];
+    }
+    return 0;
+}
+
 HbsNaryNode* hbs_nary_node_new(void* user_data, void(*free)(void* user_data)) {
     HbsNaryNode* node = malloc(sizeof(HbsNaryNode));
     if (NULL == node) {
@@ -8,7 +8,7 @@
 //
 // CREATED:         12/17/2021
 //
-// LAST EDITED:     01/06/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -49,6 +49,24 @@ void hbs_nary_tree_set_root(HbsNaryTree* tree, HbsNaryNode* node);
 int hbs_nary_tree_append_child_to_node(HbsNaryTree* tree, HbsNaryNode* parent,
     HbsNaryNode* child);
 
+// Number of nodes in the tree, including the root.
+size_t hbs_nary_tree_length(HbsNaryTree* tree);
+
+// The node at <index> of the tree, in the order of iteration (the root is
+// last). <index> must be less than the length of the tree.
+HbsNaryNode* hbs_nary_tree_node_at(HbsNaryTree* tree, size_t index);
+
+// Bytes of memory used by the tree itself, not including the user data of
+// its nodes.
+size_t hbs_nary_tree_size(HbsNaryTree* tree);
+
+// Replace the <removed> children of the root of <tree> starting at <position>
+// with the children of the root of <other>, and move the replaced children
+// into <other> in their place, so that the splice can be undone by repeating
+// it. Both trees must be flat (every node is a child of the root).
+int hbs_nary_tree_splice(HbsNaryTree* tree, size_t position, size_t removed,
+    HbsNaryTree* other);
+
 HbsNaryNode* hbs_nary_node_new(void* user_data, void(*free)(void* user_data));
 HbsNaryNode* hbs_nary_node_get_parent(HbsNaryNode* node);
 void hbs_nary_node_free(HbsNaryNode* node);
@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            output-context.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of output context handling
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+////
+
+#include <stdlib.h>
+
+#include <handlebars/handlebars.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+size_t hbs_priv_write_string(void* data, const char* buffer, size_t length)
+{
+    HbsString* string = (HbsString*)data;
+    if (0 != hbs_string_append_buffer(string, buffer, length)) {
+        return 0;
+    }
+    return length;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+HbsOutputContext* hbs_output_context_from_string(HbsString* string) {
+    HbsOutputContext* context = malloc(sizeof(HbsOutputContext));
+    if (NULL == context) {
+        return NULL;
+    }
+
+    context->data = string;
+    context->free_data = NULL;
+    context->write = hbs_priv_write_string;
+    return context;
+}
+
+void hbs_output_context_free(HbsOutputContext* output_context) {
+    if (NULL != output_context->free_data) {
+        output_context->free_data(output_context->data);
+    }
+    free(output_context);
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,7 @@
 //
 // CREATED:         12/29/2021
 //
-// LAST EDITED:     01/07/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -31,7 +31,9 @@
 ////
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <handlebars/handlebars.h>
 #include <handlebars/nary-tree.h>
@@ -43,6 +45,10 @@ typedef struct HbsParser {
     HbsVector* tokens;
     HbsScanner* scanner;
     HbsNaryNode* tree_top;
+
+    // Offset in the input of the token that caused the last parse error.
+    bool failed;
+    size_t error_offset;
 } HbsParser;
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -54,55 +60,134 @@ static void priv_parse_token_free(HbsParseToken* token) {
     free(token);
 }
 
-static void priv_component_free(void* data) {
-    HbsComponent* component = (HbsComponent*)data;
-    if (HBS_COMPONENT_TEXT == component->type && NULL != component->text) {
-        hbs_string_free(component->text);
-    } else if (HBS_COMPONENT_EXPRESSION == component->type &&
-        NULL != component->argv) {
-        hbs_vector_free(component->argv, (VectorFreeDataFn*)hbs_string_free);
-    }
-    free(data);
+static void priv_component_free(void* data)
+{ hbs_component_free((HbsComponent*)data); }
+
+// Record the location of a parse error. Only the offset is kept here; the line
+// and column are computed if the caller asks for them.
+static void priv_parser_error(HbsParser* parser, const HbsParseToken* token) {
+    parser->failed = true;
+    parser->error_offset = token->offset;
 }
 
-static int priv_parse_text(HbsParser* parser, HbsNaryTree* component_tree) {
+static int priv_parse_text(HbsParser* parser, HbsComponent** component) {
     HbsParseToken* parser_top = hbs_vector_pop_back(parser->tokens);
     assert(HBS_TOKEN_TEXT == parser_top->type); // Programmer's error.
-    HbsComponent* component = malloc(sizeof(HbsComponent));
-    component->type = HBS_COMPONENT_TEXT;
-    component->text = hbs_string_new();
-    hbs_string_append(component->text, parser_top->string);
-    HbsNaryNode* node = hbs_nary_node_new(component, priv_component_free);
-    hbs_nary_tree_append_child_to_node(component_tree, parser->tree_top,
-        node);
+    *component = calloc(1, sizeof(HbsComponent));
+    if (NULL == *component) {
+        priv_parse_token_free(parser_top);
+        return 1;
+    }
+
+    (*component)->type = HBS_COMPONENT_TEXT;
+    (*component)->offset = parser_top->offset;
+    (*component)->length = parser_top->string->length;
+    (*component)->text = hbs_string_new();
+    hbs_string_append((*component)->text, parser_top->string);
     priv_parse_token_free(parser_top);
     return 0;
 }
 
-static int priv_parse_handlebars(HbsParser* parser, HbsNaryTree* tree) {
+// Prepend the text of <token> (a text, string, slash or paren token) to the
+// first argument of <component>, or insert it as a new first argument if
+// <join> is false.
+static int priv_parse_argument(HbsComponent* component,
+    const HbsParseToken* token, bool join)
+{
+    HbsString* argument = hbs_string_new();
+    if (NULL == argument) {
+        return 1;
+    }
+
+    if (HBS_TOKEN_SLASH == token->type) {
+        hbs_string_append_str(argument, "/");
+    } else if (HBS_TOKEN_OPEN_PAREN == token->type) {
+        hbs_string_append_str(argument, "(");
+    } else if (HBS_TOKEN_CLOSE_PAREN == token->type) {
+        hbs_string_append_str(argument, ")");
+    } else {
+        hbs_string_append(argument, token->string);
+    }
+
+    if (join) {
+        HbsString* rest = component->argv->vector[0];
+        hbs_string_append(argument, rest);
+        hbs_string_free(rest);
+        component->argv->vector[0] = argument;
+    } else {
+        hbs_vector_insert(component->argv, 0, argument);
+    }
+
+    return 0;
+}
+
+// Return the length of the input covered by a text, string or slash token.
+static inline size_t priv_token_length(const HbsParseToken* token)
+{ return HBS_TOKEN_SLASH == token->type ? 1 : token->string->length; }
+
+static int priv_parse_handlebars(HbsParser* parser, HbsComponentType type,
+    HbsComponent** result)
+{
     HbsParseToken* parser_top = hbs_vector_pop_back(parser->tokens);
     assert(HBS_TOKEN_CLOSE_BARS == parser_top->type); // Programmer's error.
 
-    HbsComponent* component = malloc(sizeof(HbsComponent));
+    HbsComponent* component = calloc(1, sizeof(HbsComponent));
     if (NULL == component) {
         return 1;
     }
 
-    int result = 0;
-    component->type = HBS_COMPONENT_EXPRESSION;
+    // The component ends with the "}}" token.
+    int status = 0;
+    const size_t end = parser_top->offset + 2;
+    component->type = type;
     component->argv = hbs_vector_new();
+
+    // Text and slash tokens with no whitespace between them form a single
+    // argument (e.g. "./name"). Since the whitespace tokens are discarded,
+    // this is determined from the offsets of the tokens.
+    bool adjacent = false;
+    size_t next_offset = parser_top->offset;
     while (HBS_TOKEN_OPEN_BARS != parser_top->type) {
         priv_parse_token_free(parser_top);
         parser_top = hbs_vector_pop_back(parser->tokens);
-        if (HBS_TOKEN_TEXT == parser_top->type) {
-            HbsString* argument = hbs_string_new();
-            hbs_string_append(argument, parser_top->string);
-            hbs_vector_insert(component->argv, 0, argument);
+        // The sigils at the start of the expression have already been
+        // consumed, so these can't appear anywhere else.
+        if (HBS_TOKEN_HASH == parser_top->type
+            || HBS_TOKEN_GREATER == parser_top->type) {
+            priv_parser_error(parser, parser_top);
+            status = 1;
+            continue;
+        }
+
+        if (HBS_TOKEN_TEXT == parser_top->type
+            || HBS_TOKEN_STRING == parser_top->type
+            || HBS_TOKEN_SLASH == parser_top->type) {
+            const bool join = adjacent && parser_top->offset
+                + priv_token_length(parser_top) == next_offset;
+            if (0 != priv_parse_argument(component, parser_top, join)) {
+                status = 1;
+            }
+            adjacent = true;
+            next_offset = parser_top->offset;
+        } else if (HBS_TOKEN_OPEN_PAREN == parser_top->type
+            || HBS_TOKEN_CLOSE_PAREN == parser_top->type) {
+            // Parens are arguments of their own, which delimit the arguments
+            // of a subexpression. They're matched up at load time.
+            if (0 != priv_parse_argument(component, parser_top, false)) {
+                status = 1;
+            }
+            adjacent = false;
         } else if (HBS_TOKEN_OPEN_BARS == parser_top->type) {
             // As long as there was more than one text token between the
-            // open token and close token, this is a valid expression.
-            if (0 == component->argv->length) {
-                result = 1;
+            // open token and close token, this is a valid expression. Blocks
+            // need a name (and a key, which is checked at load time).
+            component->offset = parser_top->offset;
+            component->length = end - parser_top->offset;
+            if (0 == component->argv->length
+                || (HBS_COMPONENT_BLOCK_CLOSE == component->type
+                    && 1 != component->argv->length)) {
+                priv_parser_error(parser, parser_top);
+                status = 1;
             }
         } else {
             assert(0); // Programmer's error.
@@ -110,12 +195,17 @@ static int priv_parse_handlebars(HbsParser* parser, HbsNaryTree* tree) {
     }
 
     priv_parse_token_free(parser_top);
-    HbsNaryNode* node = hbs_nary_node_new(component, priv_component_free);
-    hbs_nary_tree_append_child_to_node(tree, parser->tree_top, node);
-    return result;
+    if (0 != status) {
+        hbs_component_free(component);
+        return status;
+    }
+
+    *result = component;
+    return 0;
 }
 
-static int priv_rule_handlebars(HbsParser* parser, HbsNaryTree* component_tree)
+static int priv_rule_handlebars(HbsParser* parser, HbsComponentType type,
+    HbsComponent** component)
 {
     int result = 1;
     HbsParseToken* parser_top = malloc(sizeof(HbsParseToken));
@@ -125,24 +215,67 @@ static int priv_rule_handlebars(HbsParser* parser, HbsNaryTree* component_tree)
 
     hbs_vector_push_back(parser->tokens, parser_top);
     hbs_scanner_next_symbol(parser->scanner, parser_top);
-    if (HBS_TOKEN_TEXT == parser_top->type) {
-        result = priv_rule_handlebars(parser, component_tree);
+    if (HBS_TOKEN_TEXT == parser_top->type
+        || HBS_TOKEN_STRING == parser_top->type
+        || HBS_TOKEN_SLASH == parser_top->type
+        || HBS_TOKEN_HASH == parser_top->type
+        || HBS_TOKEN_GREATER == parser_top->type
+        || HBS_TOKEN_OPEN_PAREN == parser_top->type
+        || HBS_TOKEN_CLOSE_PAREN == parser_top->type) {
+        result = priv_rule_handlebars(parser, type, component);
     } else if (HBS_TOKEN_CLOSE_BARS == parser_top->type) {
-        result = priv_parse_handlebars(parser, component_tree);
+        result = priv_parse_handlebars(parser, type, component);
     } else if (HBS_TOKEN_WS == parser_top->type) {
         // Pop this token from the stack and recurse
         HbsParseToken* ws_token = hbs_vector_pop_back(parser->tokens);
         assert(ws_token == parser_top);
         priv_parse_token_free(parser_top);
-        result = priv_rule_handlebars(parser, component_tree);
+        result = priv_rule_handlebars(parser, type, component);
     } else {
-        // TODO: Better error handling here
+        priv_parser_error(parser, parser_top);
     }
 
     return result;
 }
 
-static int priv_rule_expression(HbsParser* parser, HbsNaryTree* component_tree)
+// Discard the next token from the scanner, which has already been peeked at.
+static void priv_skip_token(HbsParser* parser) {
+    HbsParseToken token;
+    hbs_scanner_next_symbol(parser->scanner, &token);
+    hbs_token_release(&token);
+}
+
+// Classify the expression that was just opened, by looking ahead at the
+// sigils at its start, which are consumed: "#" opens a block and "/" closes
+// one, ">" names a partial, and "#>" opens a partial block. Whitespace may
+// come before them. Returns non-zero if the tokens can't be scanned.
+static int priv_rule_sigils(HbsParser* parser, HbsComponentType* type) {
+    HbsScanner* scanner = parser->scanner;
+    while (HBS_TOKEN_WS == hbs_scanner_peek(scanner)) {
+        priv_skip_token(parser);
+    }
+
+    const HbsParseTokenType first = hbs_scanner_peek(scanner);
+    *type = HBS_COMPONENT_EXPRESSION;
+    if (HBS_TOKEN_HASH == first) {
+        const bool partial = HBS_TOKEN_GREATER == hbs_scanner_peek_n(scanner,
+            1);
+        *type = partial ? HBS_COMPONENT_PARTIAL_BLOCK
+            : HBS_COMPONENT_BLOCK_OPEN;
+        priv_skip_token(parser);
+        if (partial) {
+            priv_skip_token(parser);
+        }
+    } else if (HBS_TOKEN_SLASH == first || HBS_TOKEN_GREATER == first) {
+        *type = HBS_TOKEN_SLASH == first ? HBS_COMPONENT_BLOCK_CLOSE
+            : HBS_COMPONENT_PARTIAL;
+        priv_skip_token(parser);
+    }
+
+    return HBS_TOKEN_NULL == hbs_scanner_peek(scanner) ? 1 : 0;
+}
+
+static int priv_rule_expression(HbsParser* parser, HbsComponent** component)
 {
     HbsParseToken* parser_top = malloc(sizeof(HbsParseToken));
     if (NULL == parser_top) {
@@ -153,21 +286,35 @@ static int priv_rule_expression(HbsParser* parser, HbsNaryTree* component_tree)
     hbs_vector_push_back(parser->tokens, parser_top);
     hbs_scanner_next_symbol(parser->scanner, parser_top);
     if (HBS_TOKEN_TEXT == parser_top->type) {
-        result = priv_parse_text(parser, component_tree);
+        result = priv_parse_text(parser, component);
     } else if (HBS_TOKEN_OPEN_BARS == parser_top->type) {
+        HbsComponentType type = HBS_COMPONENT_EXPRESSION;
         hbs_scanner_enable_hbs_tokens(parser->scanner);
-        result = priv_rule_handlebars(parser, component_tree);
+        result = priv_rule_sigils(parser, &type);
+        if (0 == result) {
+            result = priv_rule_handlebars(parser, type, component);
+        }
         hbs_scanner_disable_hbs_tokens(parser->scanner);
     } else if (HBS_TOKEN_EOF == parser_top->type) {
         result = 0; // Do nothing, but especially don't error. EOF is valid.
     } else {
-        // TODO: Some kind of error logging here.
+        priv_parser_error(parser, parser_top);
         result = 1; // Parse error
     }
 
     return result;
 }
 
+// Return true if the parser has consumed the EOF token.
+static bool priv_parser_at_eof(HbsParser* parser) {
+    if (0 == parser->tokens->length) {
+        return false;
+    }
+
+    HbsParseToken* top = parser->tokens->vector[parser->tokens->length - 1];
+    return HBS_TOKEN_EOF == top->type;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Public API
 ////
@@ -180,6 +327,8 @@ HbsParser* hbs_parser_new(HbsScanner* scanner) {
     }
 
     parser->scanner = scanner;
+    parser->failed = false;
+    parser->error_offset = 0;
     parser->tokens = hbs_vector_new();
     if (NULL == parser->tokens) {
         free(parser);
@@ -189,6 +338,19 @@ HbsParser* hbs_parser_new(HbsScanner* scanner) {
     return parser;
 }
 
+// Compute the line and column of the token that caused the last parse error.
+// Returns non-zero if no error has occurred, or the location can't be found.
+int hbs_parser_error_location(const HbsParser* parser, size_t* line,
+    size_t* column)
+{
+    if (!parser->failed) {
+        return 1;
+    }
+
+    return hbs_scanner_locate(parser->scanner, parser->error_offset, line,
+        column);
+}
+
 // Free the parser and all associated internal memory.
 void hbs_parser_free(HbsParser* parser) {
     hbs_vector_free(parser->tokens, (VectorFreeDataFn*)priv_parse_token_free);
@@ -206,7 +368,6 @@ void hbs_parser_free(HbsParser* parser) {
 // returned tree is allocated memory, which much be released using
 // hbs_nary_tree_free().
 int hbs_parser_parse(HbsParser* parser, HbsNaryTree** component_tree) {
-    int result = 0;
     *component_tree = hbs_nary_tree_new();
     if (NULL == *component_tree) {
         return 1;
@@ -221,23 +382,148 @@ int hbs_parser_parse(HbsParser* parser, HbsNaryTree** component_tree) {
     hbs_nary_tree_set_root(*component_tree, node);
     parser->tree_top = node;
 
-    HbsParseToken* top = NULL;
+    HbsComponent* component = NULL;
     do {
-        int parse_result = priv_rule_expression(parser, *component_tree);
+        int parse_result = hbs_parser_next_component(parser, &component);
         if (0 != parse_result) {
             hbs_nary_tree_free(*component_tree);
             *component_tree = NULL;
             return 1;
         }
 
-        if (0 < parser->tokens->length) {
-            top = parser->tokens->vector[parser->tokens->length - 1];
-        } else {
-            top = NULL;
+        if (NULL != component) {
+            HbsNaryNode* child = hbs_nary_node_new(component,
+                priv_component_free);
+            if (NULL == child) {
+                hbs_component_free(component);
+                hbs_nary_tree_free(*component_tree);
+                *component_tree = NULL;
+                return 1;
+            }
+            hbs_nary_tree_append_child_to_node(*component_tree,
+                parser->tree_top, child);
         }
-    } while (NULL == top || HBS_TOKEN_EOF != top->type);
+    } while (NULL != component || !priv_parser_at_eof(parser));
 
-    return result;
+    return 0;
+}
+
+// Parse the next component from the input. This allows the input to be
+// consumed incrementally, without building a tree. On success, zero is
+// returned and <component> points to a component which must be released using
+// hbs_component_free(), or NULL once the end of the input has been reached.
+int hbs_parser_next_component(HbsParser* parser, HbsComponent** component) {
+    *component = NULL;
+    if (priv_parser_at_eof(parser)) {
+        return 0;
+    }
+
+    return priv_rule_expression(parser, component);
+}
+
+// Return the argument of <component> which names a key.
+HbsString* hbs_component_key(const HbsComponent* component) {
+    const size_t index = HBS_COMPONENT_BLOCK_OPEN == component->type ? 1 : 0;
+    if (index >= component->argv->length) {
+        return NULL;
+    }
+
+    return component->argv->vector[index];
+}
+
+// Copy the type and text or arguments of <component>. The members which are
+// assigned at load time are left unset.
+HbsComponent* hbs_component_copy(const HbsComponent* component) {
+    HbsComponent* copy = calloc(1, sizeof(HbsComponent));
+    if (NULL == copy) {
+        return NULL;
+    }
+
+    copy->type = component->type;
+    if (HBS_COMPONENT_TEXT == component->type) {
+        copy->text = hbs_string_new();
+        if (NULL == copy->text
+            || 0 != hbs_string_append(copy->text, component->text)) {
+            hbs_component_free(copy);
+            return NULL;
+        }
+        return copy;
+    }
+
+    copy->argv = hbs_vector_new();
+    if (NULL == copy->argv) {
+        hbs_component_free(copy);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < component->argv->length; ++i) {
+        const HbsString* argument = component->argv->vector[i];
+        HbsString* string = hbs_string_new();
+        if (NULL == string || 0 != hbs_string_append(string, argument)
+            || 0 != hbs_vector_push_back(copy->argv, string)) {
+            if (NULL != string) {
+                hbs_string_free(string);
+            }
+            hbs_component_free(copy);
+            return NULL;
+        }
+    }
+
+    return copy;
+}
+
+// Add the bytes of memory owned by <component> to <size>, except for its
+// strings, which are added to <string_size>.
+void hbs_component_measure(const HbsComponent* component, size_t* size,
+    size_t* string_size)
+{
+    *size += sizeof(HbsComponent);
+    if (HBS_COMPONENT_TEXT == component->type && NULL != component->text) {
+        *string_size += sizeof(HbsString) + component->text->capacity;
+    } else if (HBS_COMPONENT_TEXT != component->type
+        && NULL != component->argv) {
+        *size += sizeof(HbsVector)
+            + component->argv->capacity * sizeof(void*)
+            + component->path.length * (sizeof(char*) + sizeof(size_t));
+        for (size_t i = 0; i < component->argv->length; ++i) {
+            const HbsString* argument = component->argv->vector[i];
+            *string_size += sizeof(HbsString) + argument->capacity;
+        }
+    }
+
+    *size += component->step_count * sizeof(HbsStep);
+    for (size_t i = 0; i < component->step_count; ++i) {
+        const HbsStep* step = &component->steps[i];
+        if (HBS_STEP_LITERAL == step->type
+            && HBS_VALUE_STRING == step->value.type) {
+            *string_size += strlen(step->value.string) + 1;
+        }
+        *size += step->path.length * (sizeof(char*) + sizeof(size_t));
+    }
+}
+
+// Free a component and the memory it owns.
+void hbs_component_free(HbsComponent* component) {
+    if (HBS_COMPONENT_TEXT == component->type && NULL != component->text) {
+        hbs_string_free(component->text);
+    } else if (HBS_COMPONENT_TEXT != component->type &&
+        NULL != component->argv) {
+        hbs_vector_free(component->argv, (VectorFreeDataFn*)hbs_string_free);
+        free((void*)component->path.segments);
+        free((void*)component->path.ids);
+    }
+
+    for (size_t i = 0; i < component->step_count; ++i) {
+        HbsStep* step = &component->steps[i];
+        if (HBS_STEP_LITERAL == step->type
+            && HBS_VALUE_STRING == step->value.type) {
+            free((void*)step->value.string);
+        }
+        free((void*)step->path.segments);
+        free((void*)step->path.ids);
+    }
+    free(component->steps);
+    free(component);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -8,7 +8,7 @@
 //
 // CREATED:         12/28/2021
 //
-// LAST EDITED:     01/06/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -34,13 +34,18 @@
 #ifndef HANDLEBARS_PARSER_H
 #define HANDLEBARS_PARSER_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <handlebars/handlebars.h>
+
 // Opaque typedef for the parser.
 typedef struct HbsParser HbsParser;
 
 // Forward declarations
+typedef struct HbsHelper HbsHelper;
 typedef struct HbsNaryTree HbsNaryTree;
 typedef struct HbsScanner HbsScanner;
-typedef struct HbsString HbsString;
 typedef struct HbsVector HbsVector;
 
 typedef enum HbsComponentType {
@@ -50,19 +55,113 @@ typedef enum HbsComponentType {
     // Substitution (e.g. "{{sometext}}", where "sometext" is a recognized key
     // in the template context.
     HBS_COMPONENT_EXPRESSION,
+
+    // Start and end of a block (e.g. "{{#with key}}" and "{{/with}}"). The
+    // components between them form the body of the block. The first argument
+    // is the name of the block.
+    HBS_COMPONENT_BLOCK_OPEN,
+    HBS_COMPONENT_BLOCK_CLOSE,
+
+    // Data variable of the enclosing "{{#each}}" block (e.g. "{{@index}}").
+    // The parser emits these as expressions; they're identified at load time.
+    HBS_COMPONENT_DATA,
+
+    // Call of a registered helper (e.g. "{{format created "iso"}}"), whose
+    // arguments may be subexpressions. Also emitted by the parser as an
+    // expression, and identified at load time.
+    HBS_COMPONENT_HELPER,
+
+    // Partial (e.g. "{{> header}}"), which names another template of a
+    // template set. The first argument is the name of the partial, or a
+    // subexpression which computes it, and the optional second argument is
+    // the key of the context to render it in.
+    HBS_COMPONENT_PARTIAL,
+
+    // Opening tag of a partial block (e.g. "{{#> layout}}"), closed by a
+    // BLOCK_CLOSE of the same name. Its body is the content of
+    // "{{> @partial-block}}" in the partial, and may define inline partials
+    // ("{{#*inline "title"}}...{{/inline}}") which override the partials of
+    // the same name. Template sets flatten these when linking.
+    HBS_COMPONENT_PARTIAL_BLOCK,
 } HbsComponentType;
 
+typedef enum HbsBlockType {
+    HBS_BLOCK_WITH,
+    HBS_BLOCK_EACH,
+} HbsBlockType;
+
+typedef enum HbsDataVariable {
+    HBS_DATA_INDEX,     // "@index", the index of the current element
+    HBS_DATA_KEY,       // "@key", which is the same as @index for arrays
+    HBS_DATA_FIRST,     // "@first", true for the first element
+    HBS_DATA_LAST,      // "@last", true for the last element
+} HbsDataVariable;
+
+typedef enum HbsStepType {
+    HBS_STEP_LITERAL,   // Push a literal value
+    HBS_STEP_KEY,       // Push the value of a key, resolved by the handlers
+    HBS_STEP_CALL,      // Pop the arguments of a helper, and push its result
+} HbsStepType;
+
+// A helper call, including any subexpressions (e.g. "(lower name)") in its
+// arguments, is compiled into a sequence of steps in postfix order, which are
+// evaluated on an operand stack. The last step calls the expression's helper.
+typedef struct HbsStep {
+    HbsStepType type;
+    HbsValue value;     // For literals. Strings are owned by the step.
+    const char* key;    // For keys: the key as written, and split into
+    HbsPath path;       // segments. <key> points into the component's argv.
+
+    // For calls: the helper, which is owned by the registry the template was
+    // loaded with, and how many operands it takes.
+    const HbsHelper* helper;
+    size_t argc;
+} HbsStep;
+
 typedef struct HbsComponent {
     HbsComponentType type;
     union {
         HbsString* text; // Text for HBS_COMPONENT_TEXT
         HbsVector* argv; // Arguments for a handlebars expression
     };
+
+    // Index of argv[0] in the template's key table, and argv[0] split into
+    // path segments. Not set by the parser; assigned when the template is
+    // loaded. The arrays in <path> are owned by the component.
+    size_t key_slot;
+    HbsPath path;
+
+    // For blocks: the type of block, and the distance in the template to the
+    // matching open or close component (which is relative, so that edits only
+    // have to adjust the blocks around them). Also assigned at load time.
+    HbsBlockType block;
+    size_t jump;
+
+    // For data variables: which variable. path.depth is the number of blocks
+    // between the component and the "{{#each}}" block it refers to.
+    HbsDataVariable variable;
+
+    // For helpers: the steps of the call (owned by the component).
+    HbsStep* steps;
+    size_t step_count;
+
+    // The bytes of the input that the component was parsed from, which are
+    // used to reparse the parts of editable templates that change. Not set
+    // for copies.
+    size_t offset;
+    size_t length;
 } HbsComponent;
 
 // Create a new handlebars parser, injecting the scanner.
 HbsParser* hbs_parser_new(HbsScanner* scanner);
 
+// Compute the line (starting at 1) and column (starting at 0) of the token
+// that caused the last parse error. Returns non-zero if no error has occurred,
+// or if the location can't be determined (the scanner only retains input near
+// its cursor).
+int hbs_parser_error_location(const HbsParser* parser, size_t* line,
+    size_t* column);
+
 // Free the parser and all associated internal memory.
 void hbs_parser_free(HbsParser* parser);
 
@@ -77,6 +176,28 @@ void hbs_parser_free(HbsParser* parser);
 // hbs_nary_tree_free().
 int hbs_parser_parse(HbsParser* parser, HbsNaryTree** component_tree);
 
+// Parse the next component from the input, without building a tree. On
+// success, zero is returned and <component> points to a component which must
+// be released using hbs_component_free(), or NULL once the end of the input
+// has been reached.
+int hbs_parser_next_component(HbsParser* parser, HbsComponent** component);
+
+// Return the argument of <component> which names a key: the first argument of
+// an expression, or the second argument of a block.
+HbsString* hbs_component_key(const HbsComponent* component);
+
+// Copy a component as produced by the parser, i.e. before it's been bound.
+// Returns NULL if memory can't be allocated.
+HbsComponent* hbs_component_copy(const HbsComponent* component);
+
+// Add the bytes of memory owned by <component> to <size>, except for its
+// strings, which are added to <string_size>.
+void hbs_component_measure(const HbsComponent* component, size_t* size,
+    size_t* string_size);
+
+// Free a component and the memory it owns.
+void hbs_component_free(HbsComponent* component);
+
 #endif // HANDLEBARS_PARSER_H
 
 ///////////////////////////////////////////////////////////////////////////////
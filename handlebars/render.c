@@ -0,0 +1,1382 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            render.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of template rendering
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+////
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <handlebars/handlebars.h>
+#include <handlebars/helper-cache.h>
+#include <handlebars/helper.h>
+#include <handlebars/nary-tree.h>
+#include <handlebars/parser.h>
+#include <handlebars/scanner.h>
+#include <handlebars/span-map.h>
+#include <handlebars/symbol-table.h>
+#include <handlebars/template.h>
+#include <handlebars/vector.h>
+
+// Longest run of text that hbs_render_stream() buffers before writing it.
+static const size_t STREAM_TEXT_LENGTH = 4096;
+
+// Number of components rendered between readings of the clock, when a render
+// has a time limit.
+static const size_t BUDGET_INTERVAL = 64;
+
+// A memoized value, stored in the render's memo buffer.
+typedef struct HbsMemo {
+    bool valid;
+    size_t offset;
+    size_t length;
+} HbsMemo;
+
+// The context introduced by a block. For "{{#each}}", <value> is the current
+// element of <array>.
+typedef struct HbsFrame {
+    HbsValue value;
+    HbsValue array;
+    size_t index;
+} HbsFrame;
+
+// The value of a key, resolved while specializing a template. Values of
+// constant keys are stored in a shared buffer.
+typedef struct HbsConstant {
+    bool resolved;
+    bool constant;
+    size_t offset;
+    size_t length;
+} HbsConstant;
+
+// State for a single render of a template. Everything needed to suspend and
+// resume the render lives here, so that it can be driven from an event loop.
+typedef struct HbsRender {
+    HbsTemplate* template;
+    HbsHandlers* handlers;
+    HbsString* output;
+
+    // Cursor into the template's components. <current> is the component to be
+    // rendered next, or NULL if the cursor must be advanced first.
+    HbsNaryTreeIter iterator;
+    HbsNaryNode* root;
+    HbsNaryNode* current;
+
+    // Set once the prefetch handler (if any) has completed.
+    bool prefetched;
+
+    // Used by hbs_render_step(). The rendered bytes of the current component,
+    // and how many of them have been emitted so far. Text components are
+    // emitted in place; expressions are rendered into <scratch> first.
+    const char* segment;
+    size_t segment_length;
+    size_t segment_offset;
+    HbsString* scratch;
+
+    // Operand stack for evaluating helper calls. Strings on the stack are
+    // stored in <arguments>, separated by NULs, at the offsets recorded in
+    // <offsets>. <result> holds the result of each subexpression until it's
+    // pushed.
+    HbsValue operands[HBS_MAX_OPERAND_DEPTH];
+    size_t offsets[HBS_MAX_OPERAND_DEPTH];
+    size_t operand_count;
+    HbsString* arguments;
+    HbsString* result;
+
+    // Key of the current call of a pure helper, for the registry's cache.
+    HbsString* cache_key;
+
+    // Name of the partial being rendered, if it's computed by a helper, and
+    // the number of partials enclosing this render. <nested> is the render of
+    // that partial, which is kept while it's suspended.
+    HbsString* partial_name;
+    size_t partial_depth;
+    struct HbsRender* nested;
+
+    // Memo table, indexed by key slot, and the buffer holding the memoized
+    // values. Only allocated if handlers->memoize is set.
+    HbsMemo* memo;
+    HbsString* memo_buffer;
+
+    // If non-NULL, records where the values of expressions were written to
+    // <output>.
+    HbsSpanMap* spans;
+
+    // Budget of the render (see HbsHandlers.time_limit). <started> is the
+    // time of the first check, and <written> counts the output that isn't in
+    // <output>: bytes already emitted by hbs_render_step(), or the output of
+    // the enclosing render, for partials. <countdown> is the number of
+    // components left until the clock is read again.
+    uint64_t started;
+    size_t written;
+    size_t countdown;
+    bool exhausted;
+
+    // Totals of the render, which are added to the template's statistics
+    // once it completes (and <counted> is set).
+    HbsRenderCounts counts;
+    bool counted;
+
+    // Contexts of the blocks enclosing the cursor, innermost last. Blocks
+    // can't be nested more deeply than this, which is checked at load time.
+    HbsFrame frames[HBS_MAX_BLOCK_DEPTH];
+    size_t depth;
+} HbsRender;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static uint64_t priv_clock_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+// Read the clock for the render's statistics, unless they're disabled.
+static inline uint64_t priv_stats_now(void) {
+#ifndef HBS_DISABLE_STATS
+    return priv_clock_now();
+#else
+    return 0;
+#endif
+}
+
+// Count a call of a handler, which started at <begin> (from priv_stats_now()).
+static inline void priv_count_handler(HbsRender* render, uint64_t begin) {
+    render->counts.handler_calls += 1;
+    render->counts.handler_time += priv_stats_now() - begin;
+}
+
+static void priv_string_truncate(HbsString* string, size_t length) {
+    string->length = length;
+    string->string[length] = '\0';
+}
+
+// Append <value>, produced by a handler which returned <result>, to <string>.
+static HbsResult priv_append_value(HbsResult result, const HbsValue* value,
+    HbsString* string)
+{
+    if (HBS_OK != result && HBS_VOLATILE != result) {
+        return result;
+    }
+
+    return 0 == hbs_string_append_value(string, value) ? result : HBS_ERROR;
+}
+
+// Find the context that <path> is relative to: NULL for the top level of the
+// template, or the value of one of the enclosing blocks.
+static HbsResult priv_resolve_context(const HbsRender* render,
+    const HbsPath* path, const HbsValue** context)
+{
+    if (path->depth > render->depth) {
+        return HBS_ERROR;
+    }
+
+    const size_t scope = render->depth - path->depth;
+    *context = 0 == scope ? NULL : &render->frames[scope - 1].value;
+    return HBS_OK;
+}
+
+// Invoke the typed handlers to obtain the value of <key>, which was split
+// into <path>. Only the path handler can resolve keys relative to a block's
+// context.
+static HbsResult priv_resolve_value(HbsRender* render, const HbsPath* path,
+    const char* key, HbsValue* value)
+{
+    const HbsValue* context = NULL;
+    if (HBS_OK != priv_resolve_context(render, path, &context)) {
+        return HBS_ERROR;
+    }
+
+    // "this" within a block refers to the block's value itself.
+    HbsHandlers* handlers = render->handlers;
+    if (NULL != context && 0 == path->length) {
+        *value = *context;
+        return HBS_OK;
+    } else if (NULL == handlers->path_handler
+        && (NULL != context || NULL == handlers->value_handler)) {
+        return HBS_ERROR;
+    }
+
+    const uint64_t begin = priv_stats_now();
+    HbsResult result = NULL != handlers->path_handler
+        ? handlers->path_handler(handlers->key_handler_data, context, path,
+            value)
+        : handlers->value_handler(handlers->key_handler_data, key, value);
+    priv_count_handler(render, begin);
+    return result;
+}
+
+// Invoke the handlers to append the value of the expression <component> to
+// <string>.
+static HbsResult priv_resolve_key(HbsRender* render,
+    const HbsComponent* component, HbsString* string)
+{
+    const HbsValue* context = NULL;
+    if (HBS_OK != priv_resolve_context(render, &component->path, &context)) {
+        return HBS_ERROR;
+    }
+
+    HbsHandlers* handlers = render->handlers;
+    const char* key = hbs_component_key(component)->string;
+    if (NULL != handlers->path_handler || NULL != context
+        || (NULL == handlers->write_handler
+            && NULL != handlers->value_handler)) {
+        HbsValue value = {.type = HBS_VALUE_NULL};
+        HbsResult result = priv_resolve_value(render, &component->path, key,
+            &value);
+        return priv_append_value(result, &value, string);
+    }
+
+    const uint64_t begin = priv_stats_now();
+    if (NULL != handlers->write_handler) {
+        HbsResult result = handlers->write_handler(handlers->key_handler_data,
+            key, string);
+        priv_count_handler(render, begin);
+        return result;
+    }
+
+    assert(NULL != handlers->key_handler);
+    const char* value = NULL;
+    HbsResult result = handlers->key_handler(handlers->key_handler_data, key,
+        &value);
+    priv_count_handler(render, begin);
+    if (HBS_OK != result && HBS_VOLATILE != result) {
+        return result;
+    }
+
+    return 0 == hbs_string_append_str(string, value) ? result : HBS_ERROR;
+}
+
+// Record the span of the output from <start> to its end as the value of
+// <component>, if it's relative to the top level of the template. Values
+// relative to blocks can't be patched without rendering the blocks again.
+static HbsResult priv_record_span(HbsRender* render,
+    const HbsComponent* component, const HbsString* string, size_t start)
+{
+    if (NULL == render->spans || render->output != string
+        || render->depth != component->path.depth) {
+        return HBS_OK;
+    }
+
+    return 0 == hbs_span_map_record(render->spans, component->key_slot, start,
+        string->length - start) ? HBS_OK : HBS_ERROR;
+}
+
+static HbsResult priv_render_substitution(HbsRender* render,
+    HbsComponent* component, HbsString* string)
+{
+    // Only keys resolved against the top level have the same value throughout
+    // the render.
+    const size_t start = string->length;
+    HbsMemo* memo = NULL;
+    if (NULL != render->memo && render->depth == component->path.depth) {
+        memo = &render->memo[component->key_slot];
+        if (memo->valid) {
+            return 0 == hbs_string_append_buffer(string,
+                render->memo_buffer->string + memo->offset, memo->length)
+                ? priv_record_span(render, component, string, start)
+                : HBS_ERROR;
+        }
+    }
+
+    HbsResult result = priv_resolve_key(render, component, string);
+    if (HBS_PENDING == result) {
+        // Discard anything the handler may have written; it will be asked
+        // again when the render is resumed.
+        priv_string_truncate(string, start);
+        return HBS_PENDING;
+    } else if (HBS_OK != result && HBS_VOLATILE != result) {
+        return HBS_ERROR;
+    }
+
+    if (NULL != memo && HBS_OK == result) {
+        memo->offset = render->memo_buffer->length;
+        memo->length = string->length - start;
+        if (0 != hbs_string_append_buffer(render->memo_buffer,
+                string->string + start, memo->length)) {
+            return HBS_ERROR;
+        }
+        memo->valid = true;
+    }
+    return priv_record_span(render, component, string, start);
+}
+
+// Continue rendering from the component after the one at <position>.
+static inline void priv_render_jump(HbsRender* render, size_t position)
+{ render->iterator.index = position + 1; }
+
+// Return the position of the component being rendered.
+static inline size_t priv_render_position(const HbsRender* render)
+{ return render->iterator.index - 1; }
+
+// Return true if "{{#with}}" should skip its body for <value>.
+static bool priv_value_is_empty(const HbsValue* value) {
+    switch (value->type) {
+    case HBS_VALUE_NULL: return true;
+    case HBS_VALUE_BOOL: return !value->bool_value;
+    case HBS_VALUE_STRING: return NULL == value->string;
+    case HBS_VALUE_OBJECT: return NULL == value->object.pointer;
+    default: return false;
+    }
+}
+
+// Enter a block, pushing its context, or skip past it if it's empty. Nothing
+// is pushed until the handlers have succeeded, so a pending block is simply
+// entered again when the render is resumed.
+static HbsResult priv_render_block_open(HbsRender* render,
+    const HbsComponent* component)
+{
+    HbsFrame frame = {.value.type = HBS_VALUE_NULL, .index = 0};
+    HbsResult result = priv_resolve_value(render, &component->path,
+        hbs_component_key(component)->string, &frame.value);
+    if (HBS_OK != result && HBS_VOLATILE != result) {
+        return HBS_PENDING == result ? result : HBS_ERROR;
+    }
+
+    bool empty = priv_value_is_empty(&frame.value);
+    if (HBS_BLOCK_EACH == component->block) {
+        frame.array = frame.value;
+        empty = HBS_VALUE_ARRAY != frame.array.type
+            || 0 == frame.array.object.length;
+        if (!empty && NULL == render->handlers->each_handler) {
+            return HBS_ERROR;
+        }
+
+        frame.value.type = HBS_VALUE_NULL;
+        if (!empty) {
+            const uint64_t begin = priv_stats_now();
+            result = render->handlers->each_handler(
+                render->handlers->key_handler_data, &frame.array, 0,
+                &frame.value);
+            priv_count_handler(render, begin);
+        }
+        if (HBS_OK != result && HBS_VOLATILE != result) {
+            return HBS_PENDING == result ? result : HBS_ERROR;
+        }
+    }
+
+    if (empty) {
+        priv_render_jump(render,
+            priv_render_position(render) + component->jump);
+        return HBS_OK;
+    }
+
+    render->frames[render->depth++] = frame;
+    return HBS_OK;
+}
+
+// Leave a block, or go back to the start of its body for the next element.
+static HbsResult priv_render_block_close(HbsRender* render,
+    const HbsComponent* component)
+{
+    assert(0 < render->depth); // Checked at load time.
+    HbsFrame* frame = &render->frames[render->depth - 1];
+    if (HBS_BLOCK_EACH == component->block
+        && frame->index + 1 < frame->array.object.length) {
+        HbsValue element = {.type = HBS_VALUE_NULL};
+        const uint64_t begin = priv_stats_now();
+        HbsResult result = render->handlers->each_handler(
+            render->handlers->key_handler_data, &frame->array,
+            frame->index + 1, &element);
+        priv_count_handler(render, begin);
+        if (HBS_OK != result && HBS_VOLATILE != result) {
+            return HBS_PENDING == result ? result : HBS_ERROR;
+        }
+
+        frame->index += 1;
+        frame->value = element;
+        priv_render_jump(render,
+            priv_render_position(render) - component->jump);
+        return HBS_OK;
+    }
+
+    render->depth -= 1;
+    return HBS_OK;
+}
+
+// Format a data variable of the enclosing "{{#each}}" block. These come from
+// the render's own counters, without calling any handlers.
+static HbsResult priv_render_data(const HbsRender* render,
+    const HbsComponent* component, HbsString* string)
+{
+    if (component->path.depth >= render->depth) {
+        return HBS_ERROR;
+    }
+
+    const HbsFrame* frame = &render->frames[
+        render->depth - 1 - component->path.depth];
+    HbsValue value = {.type = HBS_VALUE_BOOL};
+    switch (component->variable) {
+    case HBS_DATA_INDEX:
+    case HBS_DATA_KEY:
+        value.type = HBS_VALUE_UINT;
+        value.uint_value = frame->index;
+        break;
+    case HBS_DATA_FIRST:
+        value.bool_value = 0 == frame->index;
+        break;
+    case HBS_DATA_LAST:
+        value.bool_value = frame->index + 1 == frame->array.object.length;
+        break;
+    }
+
+    return 0 == hbs_string_append_value(string, &value) ? HBS_OK : HBS_ERROR;
+}
+
+// Push the value of the literal or key <step> onto the operand stack. Strings
+// are copied into the argument buffer (NUL-terminated), and their offset
+// recorded, because a handler's string is only valid until the handler is
+// called again. The offset is SIZE_MAX for values that aren't copied.
+static HbsResult priv_push_operand(HbsRender* render, const HbsStep* step) {
+    HbsValue* value = &render->operands[render->operand_count];
+    size_t* offset = &render->offsets[render->operand_count];
+    *offset = SIZE_MAX;
+    if (HBS_STEP_LITERAL == step->type) {
+        *value = step->value;
+        render->operand_count += 1;
+        return HBS_OK;
+    }
+
+    const HbsValue* context = NULL;
+    if (HBS_OK != priv_resolve_context(render, &step->path, &context)) {
+        return HBS_ERROR;
+    }
+
+    // As for expressions, but the untyped handlers produce strings.
+    HbsHandlers* handlers = render->handlers;
+    HbsString* buffer = render->arguments;
+    HbsResult result = HBS_OK;
+    const size_t start = buffer->length;
+    value->type = HBS_VALUE_NULL;
+    if (NULL != handlers->path_handler || NULL != context
+        || NULL != handlers->value_handler) {
+        result = priv_resolve_value(render, &step->path, step->key, value);
+    } else if (NULL != handlers->write_handler) {
+        value->type = HBS_VALUE_STRING;
+        value->string = NULL;
+        const uint64_t begin = priv_stats_now();
+        result = handlers->write_handler(handlers->key_handler_data,
+            step->key, buffer);
+        priv_count_handler(render, begin);
+        *offset = start;
+    } else {
+        value->type = HBS_VALUE_STRING;
+        const uint64_t begin = priv_stats_now();
+        result = handlers->key_handler(handlers->key_handler_data,
+            step->key, &value->string);
+        priv_count_handler(render, begin);
+    }
+
+    if (HBS_OK != result && HBS_VOLATILE != result) {
+        return HBS_PENDING == result ? result : HBS_ERROR;
+    }
+
+    // The write handler has already appended its value.
+    render->operand_count += 1;
+    if (HBS_VALUE_STRING != value->type
+        || (NULL == value->string && SIZE_MAX == *offset)) {
+        return HBS_OK;
+    } else if (SIZE_MAX == *offset) {
+        *offset = start;
+        if (0 != hbs_string_append_str(buffer, value->string)) {
+            return HBS_ERROR;
+        }
+    }
+    return 0 == hbs_string_append_buffer(buffer, "", 1) ? HBS_OK : HBS_ERROR;
+}
+
+// Pop the arguments of the call <step> from the operand stack, and invoke its
+// helper, which appends its result to <output>.
+static HbsResult priv_call_helper(HbsRender* render, const HbsStep* step,
+    HbsString* output)
+{
+    // The argument buffer may have moved as it grew, so the strings are only
+    // pointed into it now.
+    render->operand_count -= step->argc;
+    HbsValue* argv = &render->operands[render->operand_count];
+    const size_t* offsets = &render->offsets[render->operand_count];
+    for (size_t i = 0; i < step->argc; ++i) {
+        if (SIZE_MAX != offsets[i]) {
+            argv[i].string = render->arguments->string + offsets[i];
+        }
+    }
+
+    // Pure helpers are called only if their result isn't already cached.
+    const HbsHelper* helper = step->helper;
+    bool cacheable = false;
+    if (0 != (HBS_HELPER_PURE & helper->flags)) {
+        priv_string_truncate(render->cache_key, 0);
+        cacheable = 0 == hbs_helper_cache_key(helper, step->argc, argv,
+            render->cache_key);
+        if (cacheable && 0 == hbs_helper_cache_lookup(helper->cache,
+                render->cache_key->string, render->cache_key->length,
+                output)) {
+            return HBS_OK;
+        }
+    }
+
+    const size_t start = output->length;
+    HbsResult result = helper->function(helper->data, step->argc, argv,
+        output);
+    if (HBS_PENDING == result) {
+        priv_string_truncate(output, start);
+        return HBS_PENDING;
+    } else if (cacheable && HBS_OK == result) {
+        hbs_helper_cache_insert(helper->cache, render->cache_key->string,
+            render->cache_key->length, output->string + start,
+            output->length - start);
+    }
+    return HBS_OK == result || HBS_VOLATILE == result ? HBS_OK : HBS_ERROR;
+}
+
+// Evaluate the steps of the helper <component>, and append the result of the
+// helper to <string>. The result of each subexpression is copied into the
+// argument buffer and pushed as a string, so once the buffers have grown to
+// fit, no memory is allocated. Helpers are never memoized, since their output
+// may depend on anything.
+static HbsResult priv_render_helper(HbsRender* render,
+    const HbsComponent* component, HbsString* string)
+{
+    if (NULL == render->arguments) {
+        render->arguments = hbs_string_new();
+        render->result = hbs_string_new();
+        render->cache_key = hbs_string_new();
+        if (NULL == render->arguments || NULL == render->result
+            || NULL == render->cache_key) {
+            return HBS_ERROR;
+        }
+    }
+
+    priv_string_truncate(render->arguments, 0);
+    render->operand_count = 0;
+    const HbsStep* last = &component->steps[component->step_count - 1];
+    for (const HbsStep* step = component->steps; step < last; ++step) {
+        HbsResult result = HBS_OK;
+        if (HBS_STEP_CALL != step->type) {
+            result = priv_push_operand(render, step);
+        } else {
+            priv_string_truncate(render->result, 0);
+            result = priv_call_helper(render, step, render->result);
+            render->operands[render->operand_count] = (HbsValue){
+                .type = HBS_VALUE_STRING};
+            render->offsets[render->operand_count++] =
+                render->arguments->length;
+            if (HBS_OK == result && 0 != hbs_string_append_buffer(
+                    render->arguments, render->result->string,
+                    render->result->length + 1)) {
+                result = HBS_ERROR;
+            }
+        }
+
+        if (HBS_OK != result) {
+            return result;
+        }
+    }
+
+    return priv_call_helper(render, last, string);
+}
+
+// Return the number of bytes that the render has produced so far.
+static inline size_t priv_render_length(const HbsRender* render) {
+    return render->written
+        + (NULL != render->output ? render->output->length : 0);
+}
+
+// Return HBS_ERROR_BUDGET if the render has exceeded the limits in its
+// handlers, freeing the output. Once exhausted, the render can't continue.
+static HbsResult priv_render_check_budget(HbsRender* render) {
+    const HbsHandlers* handlers = render->handlers;
+    if (!render->exhausted && 0 != handlers->max_output_length) {
+        render->exhausted = priv_render_length(render)
+            > handlers->max_output_length;
+    }
+
+    if (!render->exhausted && 0 != handlers->time_limit) {
+        if (0 < render->countdown) {
+            render->countdown -= 1;
+        } else {
+            const uint64_t now = priv_clock_now();
+            render->started = 0 == render->started ? now : render->started;
+            render->exhausted = now - render->started > handlers->time_limit;
+            render->countdown = BUDGET_INTERVAL;
+        }
+    }
+
+    if (render->exhausted && NULL != render->output) {
+        hbs_string_free(render->output);
+        render->output = NULL;
+    }
+    return render->exhausted ? HBS_ERROR_BUDGET : HBS_OK;
+}
+
+static HbsResult priv_render_resume(HbsRender* render);
+
+// Start a nested render of the partial whose name is computed by the helper
+// <component>. The partial is looked up in the template's set.
+static HbsResult priv_render_partial_new(HbsRender* render,
+    const HbsComponent* component, const HbsString* string)
+{
+    if (NULL == render->partial_name) {
+        render->partial_name = hbs_string_new();
+        if (NULL == render->partial_name) {
+            return HBS_ERROR;
+        }
+    }
+
+    priv_string_truncate(render->partial_name, 0);
+    HbsResult result = priv_render_helper(render, component,
+        render->partial_name);
+    if (HBS_OK != result) {
+        return result;
+    }
+
+    HbsTemplate* partial = hbs_template_set_get(render->template->set,
+        render->partial_name->string);
+    HbsRender* nested = NULL != partial
+        ? hbs_render_new(partial, render->handlers) : NULL;
+    if (NULL == nested) {
+        return HBS_ERROR;
+    }
+
+    // The partial shares the budget of this render. Its keys aren't
+    // prefetched, since the prefetch handler is only called at the start of
+    // the render.
+    nested->partial_depth = render->partial_depth + 1;
+    nested->prefetched = true;
+    nested->started = render->started;
+    nested->written = priv_render_length(render)
+        + (string != render->output ? string->length : 0);
+    render->nested = nested;
+    return HBS_OK;
+}
+
+// Render a partial whose name is computed by a helper, in the top level
+// context, by a nested render. If the nested render is suspended, it's kept,
+// and continued when this component is rendered again.
+static HbsResult priv_render_partial(HbsRender* render,
+    const HbsComponent* component, HbsString* string)
+{
+    if (NULL == render->template || NULL == render->template->set
+        || HBS_MAX_PARTIAL_DEPTH <= render->partial_depth) {
+        return HBS_ERROR;
+    }
+
+    HbsResult result = HBS_OK;
+    if (NULL == render->nested) {
+        result = priv_render_partial_new(render, component, string);
+        if (HBS_OK != result) {
+            return result;
+        }
+    }
+
+    HbsRender* nested = render->nested;
+    result = priv_render_resume(nested);
+    if (HBS_PENDING == result) {
+        return result;
+    } else if (HBS_OK == result
+        && 0 != hbs_string_append(string, nested->output)) {
+        result = HBS_ERROR;
+    }
+
+    // The partial counts towards the statistics of this render, rather than
+    // those of the partial.
+    render->counts.handler_calls += nested->counts.handler_calls;
+    render->counts.handler_time += nested->counts.handler_time;
+    hbs_render_free(nested);
+    render->nested = NULL;
+    return HBS_OK == result || HBS_ERROR_BUDGET == result
+        ? result : HBS_ERROR;
+}
+
+static HbsResult priv_render_component(HbsRender* render,
+    HbsComponent* component, HbsString* result)
+{
+    switch (component->type) {
+    case HBS_COMPONENT_TEXT:
+        return 0 == hbs_string_append(result, component->text)
+            ? HBS_OK : HBS_ERROR;
+
+    case HBS_COMPONENT_EXPRESSION: {
+        if (1 == component->argv->length) {
+            return priv_render_substitution(render, component, result);
+        } else {
+            return HBS_ERROR;
+        }
+    }
+
+    case HBS_COMPONENT_DATA:
+        return priv_render_data(render, component, result);
+
+    case HBS_COMPONENT_HELPER:
+        return priv_render_helper(render, component, result);
+
+    case HBS_COMPONENT_PARTIAL:
+        return priv_render_partial(render, component, result);
+
+    // Blocks render nothing themselves, but move the cursor. They need the
+    // template's components, so they can't be streamed.
+    case HBS_COMPONENT_BLOCK_OPEN:
+        return NULL != render->template
+            ? priv_render_block_open(render, component) : HBS_ERROR;
+    case HBS_COMPONENT_BLOCK_CLOSE:
+        return NULL != render->template
+            ? priv_render_block_close(render, component) : HBS_ERROR;
+
+    default:
+        return HBS_ERROR;
+    }
+}
+
+static HbsResult priv_render_prefetch(HbsRender* render) {
+    HbsHandlers* handlers = render->handlers;
+    if (render->prefetched || NULL == handlers->prefetch) {
+        render->prefetched = true;
+        return HBS_OK;
+    }
+
+    HbsSymbolTable* table = render->template->keys;
+    const size_t length = hbs_symbol_table_length(table);
+    const char* const* keys = hbs_symbol_table_symbols(table);
+    const uint64_t begin = priv_stats_now();
+    HbsResult result = handlers->prefetch(handlers->key_handler_data, keys,
+        length);
+    priv_count_handler(render, begin);
+    if (HBS_OK == result) {
+        render->prefetched = true;
+    }
+    return HBS_PENDING == result || HBS_OK == result ? result : HBS_ERROR;
+}
+
+// Return the component under the cursor, or NULL if the render is complete.
+static HbsComponent* priv_render_current(HbsRender* render) {
+    if (NULL == render->current) {
+        render->current = hbs_nary_tree_iter_next(&render->iterator);
+    }
+
+    if (render->root == render->current) {
+        return NULL;
+    }
+    return hbs_nary_node_get_data(render->current);
+}
+
+// Move the cursor past the current component.
+static inline void priv_render_advance(HbsRender* render)
+{ render->current = NULL; }
+
+// Render the current component into the segment buffer and advance.
+static HbsResult priv_render_fill_segment(HbsRender* render,
+    HbsComponent* component)
+{
+    render->segment_offset = 0;
+    if (HBS_COMPONENT_TEXT == component->type) {
+        render->segment = component->text->string;
+        render->segment_length = component->text->length;
+        priv_render_advance(render);
+        return HBS_OK;
+    }
+
+    if (NULL == render->scratch) {
+        render->scratch = hbs_string_new();
+        if (NULL == render->scratch) {
+            return HBS_ERROR;
+        }
+    }
+
+    priv_string_truncate(render->scratch, 0);
+    render->segment_length = 0;
+    HbsResult result = priv_render_component(render, component,
+        render->scratch);
+    if (HBS_OK != result) {
+        return result;
+    }
+
+    render->segment = render->scratch->string;
+    render->segment_length = render->scratch->length;
+    priv_render_advance(render);
+    return HBS_OK;
+}
+
+// Create a text component containing <length> bytes of <text>.
+static HbsComponent* priv_text_component(const char* text, size_t length) {
+    HbsComponent* component = calloc(1, sizeof(HbsComponent));
+    if (NULL == component) {
+        return NULL;
+    }
+
+    component->type = HBS_COMPONENT_TEXT;
+    component->text = hbs_string_new();
+    if (NULL == component->text
+        || 0 != hbs_string_append_buffer(component->text, text, length)) {
+        hbs_component_free(component);
+        return NULL;
+    }
+    return component;
+}
+
+// Resolve the key of <component>, which is relative to the top level of the
+// template, once per key. Returns HBS_OK and a text component containing its
+// value in <folded> if the key is constant, or HBS_VOLATILE if it isn't.
+static HbsResult priv_fold_key(HbsRender* render,
+    const HbsComponent* component, HbsConstant* constants, HbsString* values,
+    HbsComponent** folded)
+{
+    HbsConstant* constant = &constants[component->key_slot];
+    if (!constant->resolved) {
+        // Keys which climb out of every enclosing block ("../name") resolve
+        // exactly as they would outside of the blocks.
+        HbsComponent top = *component;
+        top.path.depth = 0;
+        const size_t start = values->length;
+        HbsResult result = priv_resolve_key(render, &top, values);
+        if (HBS_OK != result && HBS_VOLATILE != result) {
+            return HBS_ERROR;
+        }
+
+        constant->resolved = true;
+        constant->constant = HBS_OK == result;
+        constant->offset = start;
+        constant->length = values->length - start;
+    }
+
+    if (!constant->constant) {
+        return HBS_VOLATILE;
+    }
+
+    *folded = priv_text_component(values->string + constant->offset,
+        constant->length);
+    return NULL != *folded ? HBS_OK : HBS_ERROR;
+}
+
+// Append <component> to <tree>, taking ownership of it. Text is merged into
+// the last component appended, <*text>, if that was text as well.
+static int priv_specialize_append(HbsNaryTree* tree, HbsNaryNode* root,
+    HbsComponent** text, HbsComponent* component)
+{
+    if (HBS_COMPONENT_TEXT == component->type && NULL != *text) {
+        int result = hbs_string_append((*text)->text, component->text);
+        hbs_component_free(component);
+        return result;
+    }
+
+    HbsNaryNode* node = hbs_nary_node_new(component,
+        (void (*)(void*))hbs_component_free);
+    if (NULL == node) {
+        hbs_component_free(component);
+        return 1;
+    }
+
+    hbs_nary_tree_append_child_to_node(tree, root, node);
+    *text = HBS_COMPONENT_TEXT == component->type ? component : NULL;
+    return 0;
+}
+
+// Copy the components of <template> into <tree>, folding the values of
+// constant keys into the surrounding text.
+static int priv_specialize_components(HbsTemplate* template,
+    HbsHandlers* handlers, HbsConstant* constants, HbsString* values,
+    HbsNaryTree* tree)
+{
+    HbsRender render = {.template = template, .handlers = handlers};
+    HbsNaryNode* root = hbs_nary_tree_get_root(tree);
+    HbsNaryTreeIter iterator;
+    hbs_nary_tree_iter_init(&iterator, template->components);
+    HbsNaryNode* end = hbs_nary_tree_get_root(template->components);
+    HbsNaryNode* element = NULL;
+    HbsComponent* text = NULL;
+    size_t depth = 0;
+    while (end != (element = hbs_nary_tree_iter_next(&iterator))) {
+        const HbsComponent* component = hbs_nary_node_get_data(element);
+        depth -= HBS_COMPONENT_BLOCK_CLOSE == component->type ? 1 : 0;
+
+        HbsComponent* copy = NULL;
+        if (HBS_COMPONENT_EXPRESSION == component->type
+            && depth == component->path.depth
+            && HBS_ERROR == priv_fold_key(&render, component, constants,
+                values, &copy)) {
+            return 1;
+        }
+
+        depth += HBS_COMPONENT_BLOCK_OPEN == component->type ? 1 : 0;
+        if (NULL == copy && NULL == (copy = hbs_component_copy(component))) {
+            return 1;
+        }
+        if (0 != priv_specialize_append(tree, root, &text, copy)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// Build the component tree of the specialization of <template>.
+static HbsNaryTree* priv_specialize(HbsTemplate* template,
+    HbsHandlers* handlers)
+{
+    HbsNaryTree* tree = hbs_nary_tree_new();
+    if (NULL == tree) {
+        return NULL;
+    }
+
+    HbsNaryNode* root = hbs_nary_node_new(NULL, NULL);
+    if (NULL == root) {
+        hbs_nary_tree_free(tree);
+        return NULL;
+    }
+
+    hbs_nary_tree_set_root(tree, root);
+    const size_t key_count = hbs_symbol_table_length(template->keys);
+    HbsConstant* constants = calloc(key_count + 1, sizeof(HbsConstant));
+    HbsString* values = hbs_string_new();
+    if (NULL == constants || NULL == values
+        || 0 != priv_specialize_components(template, handlers, constants,
+            values, tree)) {
+        hbs_nary_tree_free(tree);
+        tree = NULL;
+    }
+
+    if (NULL != values) {
+        hbs_string_free(values);
+    }
+    free(constants);
+    return tree;
+}
+
+// Render <template> again from scratch, replacing <output> and <span_map>.
+static int priv_render_again(HbsTemplate* template, HbsHandlers* handlers,
+    HbsString* output, HbsSpanMap* span_map)
+{
+    HbsSpanMap* spans = NULL;
+    HbsString* rendered = hbs_template_render_spans(template, handlers,
+        &spans);
+    if (NULL == rendered) {
+        return 1;
+    }
+
+    HbsString swap = *output;
+    *output = *rendered;
+    *rendered = swap;
+    hbs_string_free(rendered);
+    hbs_span_map_replace(span_map, spans);
+    return 0;
+}
+
+// Resolve the changed keys of <template>, and patch their spans in <output>.
+static int priv_rerender(HbsTemplate* template, HbsHandlers* handlers,
+    HbsString* output, HbsSpanMap* span_map, const size_t* changed,
+    size_t length)
+{
+    for (size_t i = 0; i < length; ++i) {
+        if (changed[i] >= span_map->key_count) {
+            return 1;
+        } else if (span_map->keys[changed[i]].structural) {
+            return priv_render_again(template, handlers, output, span_map);
+        }
+    }
+
+    HbsString* values = hbs_string_new();
+    if (NULL == values) {
+        return 1;
+    }
+
+    HbsRender render = {.template = template, .handlers = handlers};
+    for (size_t i = 0; i < length; ++i) {
+        HbsSpanKey* key = &span_map->keys[changed[i]];
+        if (key->changed || HBS_SPAN_NONE == key->component) {
+            continue;
+        }
+
+        // The value of the key doesn't depend on the blocks enclosing its
+        // expressions, so it's resolved as if at the top level.
+        HbsComponent top = *(HbsComponent*)hbs_nary_node_get_data(
+            hbs_nary_tree_node_at(template->components, key->component));
+        top.path.depth = 0;
+        key->value_offset = values->length;
+        HbsResult result = priv_resolve_key(&render, &top, values);
+        if (HBS_OK != result && HBS_VOLATILE != result) {
+            hbs_span_map_reset(span_map);
+            hbs_string_free(values);
+            return 1;
+        }
+
+        key->value_length = values->length - key->value_offset;
+        key->changed = true;
+    }
+
+    int result = hbs_span_map_patch(span_map, output, values);
+    hbs_string_free(values);
+    return result;
+}
+
+// Add the time spent in the render since <begin> to its statistics, and
+// count it in its template's once it's complete.
+static void priv_render_count(HbsRender* render, uint64_t begin) {
+    render->counts.time += priv_stats_now() - begin;
+    if (!render->counted && render->root == render->current) {
+        render->counts.bytes = priv_render_length(render);
+        hbs_template_count_render(render->template, &render->counts);
+        render->counted = true;
+    }
+}
+
+static HbsResult priv_render_resume(HbsRender* render) {
+    HbsResult result = priv_render_prefetch(render);
+    if (HBS_OK != result) {
+        return result;
+    }
+
+    HbsComponent* component = NULL;
+    while (HBS_OK == (result = priv_render_check_budget(render))
+           && NULL != (component = priv_render_current(render))) {
+        result = priv_render_component(render, component, render->output);
+        if (HBS_OK != result) {
+            return result;
+        }
+        priv_render_advance(render);
+    }
+
+    return result;
+}
+
+static HbsResult priv_render_step(HbsRender* render, char* buffer,
+    size_t capacity, size_t* written)
+{
+    *written = 0;
+    HbsResult result = priv_render_prefetch(render);
+    if (HBS_OK != result) {
+        return result;
+    }
+
+    while (*written < capacity) {
+        if (render->segment_offset < render->segment_length) {
+            size_t length = render->segment_length - render->segment_offset;
+            if (length > capacity - *written) {
+                length = capacity - *written;
+            }
+
+            memcpy(buffer + *written, render->segment + render->segment_offset,
+                length);
+            render->segment_offset += length;
+            render->written += length;
+            *written += length;
+            continue;
+        }
+
+        result = priv_render_check_budget(render);
+        if (HBS_OK != result) {
+            return result;
+        }
+
+        HbsComponent* component = priv_render_current(render);
+        if (NULL == component) {
+            break;
+        }
+
+        result = priv_render_fill_segment(render, component);
+        if (HBS_OK != result) {
+            return result;
+        }
+    }
+
+    return HBS_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+// Prepare to render <template>. The render holds references to <template> and
+// <handlers>, which must outlive it.
+HbsRender* hbs_render_new(HbsTemplate* template, HbsHandlers* handlers) {
+    HbsRender* render = malloc(sizeof(HbsRender));
+    if (NULL == render) {
+        return NULL;
+    }
+
+    memset(render, 0, sizeof(HbsRender));
+    if (0 != hbs_template_acquire(template)) {
+        free(render);
+        return NULL;
+    }
+
+    render->template = template;
+    render->handlers = handlers;
+    hbs_nary_tree_iter_init(&render->iterator, template->components);
+    render->root = hbs_nary_tree_get_root(template->components);
+    render->output = hbs_string_new();
+    if (NULL == render->output) {
+        hbs_render_free(render);
+        return NULL;
+    }
+
+    if (handlers->memoize) {
+        const size_t key_count = hbs_symbol_table_length(template->keys);
+        render->memo = calloc(key_count + 1, sizeof(HbsMemo));
+        render->memo_buffer = hbs_string_new();
+        if (NULL == render->memo || NULL == render->memo_buffer) {
+            hbs_render_free(render);
+            return NULL;
+        }
+    }
+
+    return render;
+}
+
+// Render until the template is complete, or until a handler returns
+// HBS_PENDING. In the latter case, the render stops at the expression that
+// is pending, and that handler will be invoked again for the same key the
+// next time this function is called.
+HbsResult hbs_render_resume(HbsRender* render) {
+    const uint64_t begin = priv_stats_now();
+    HbsResult result = priv_render_resume(render);
+    priv_render_count(render, begin);
+    return result;
+}
+
+// Emit at most <capacity> bytes of output into <buffer>, which is not
+// NUL-terminated. Output is produced incrementally, so the render never
+// buffers more than one expression's value at a time.
+HbsResult hbs_render_step(HbsRender* render, char* buffer, size_t capacity,
+    size_t* written)
+{
+    const uint64_t begin = priv_stats_now();
+    HbsResult result = priv_render_step(render, buffer, capacity, written);
+    priv_render_count(render, begin);
+    return result;
+}
+
+// Return the rendered output, transferring ownership to the caller.
+HbsString* hbs_render_take_output(HbsRender* render) {
+    HbsString* output = render->output;
+    render->output = NULL;
+    return output;
+}
+
+// Free the render and any output that has not been taken.
+void hbs_render_free(HbsRender* render) {
+    hbs_template_release(render->template);
+    if (NULL != render->output) {
+        hbs_string_free(render->output);
+    }
+
+    free(render->memo);
+    if (NULL != render->memo_buffer) {
+        hbs_string_free(render->memo_buffer);
+    }
+
+    if (NULL != render->scratch) {
+        hbs_string_free(render->scratch);
+    }
+
+    if (NULL != render->arguments) {
+        hbs_string_free(render->arguments);
+    }
+
+    if (NULL != render->result) {
+        hbs_string_free(render->result);
+    }
+
+    if (NULL != render->cache_key) {
+        hbs_string_free(render->cache_key);
+    }
+
+    if (NULL != render->partial_name) {
+        hbs_string_free(render->partial_name);
+    }
+
+    if (NULL != render->nested) {
+        hbs_render_free(render->nested);
+    }
+
+    if (NULL != render->spans) {
+        hbs_span_map_free(render->spans);
+    }
+    free(render);
+}
+
+// Render a template straight from the input, one component at a time. The
+// parser hands over each component as soon as it's complete, and it's written
+// to the output and discarded immediately.
+HbsResult hbs_render_stream(HbsInputContext* input_context,
+    HbsHandlers* handlers, HbsOutputContext* output_context)
+{
+    HbsScanner* scanner = hbs_scanner_new(input_context);
+    if (NULL == scanner) {
+        return HBS_ERROR;
+    }
+    hbs_scanner_set_max_text_length(scanner, STREAM_TEXT_LENGTH);
+
+    HbsParser* parser = hbs_parser_new(scanner);
+    if (NULL == parser) {
+        hbs_scanner_free(scanner);
+        return HBS_ERROR;
+    }
+
+    // There's no template, so memoization is unavailable. Expressions are
+    // still bound as they're parsed, for the path handler.
+    HbsRender render;
+    memset(&render, 0, sizeof(HbsRender));
+    render.handlers = handlers;
+    render.scratch = hbs_string_new();
+    HbsSymbolTable* keys = hbs_symbol_table_new();
+    HbsSymbolTable* segments = hbs_symbol_table_new();
+
+    HbsResult result = NULL != render.scratch && NULL != keys
+        && NULL != segments ? HBS_OK : HBS_ERROR;
+    while (HBS_OK == result
+           && HBS_OK == (result = priv_render_check_budget(&render))) {
+        HbsComponent* component = NULL;
+        if (0 != hbs_parser_next_component(parser, &component)) {
+            result = HBS_ERROR;
+            break;
+        } else if (NULL == component) {
+            break;
+        }
+
+        const HbsString* segment = component->text;
+        if (HBS_COMPONENT_TEXT != component->type) {
+            priv_string_truncate(render.scratch, 0);
+            result = HBS_ERROR;
+            if (0 == hbs_component_bind(component, keys, segments, NULL)) {
+                result = priv_render_component(&render, component,
+                    render.scratch);
+            }
+            segment = render.scratch;
+        }
+
+        if (HBS_OK == result && segment->length != output_context->write(
+                output_context->data, segment->string, segment->length)) {
+            result = HBS_ERROR;
+        }
+        render.written += segment->length;
+        hbs_component_free(component);
+    }
+
+    if (NULL != render.scratch) {
+        hbs_string_free(render.scratch);
+    }
+    if (NULL != render.arguments) {
+        hbs_string_free(render.arguments);
+    }
+    if (NULL != render.result) {
+        hbs_string_free(render.result);
+    }
+    if (NULL != render.cache_key) {
+        hbs_string_free(render.cache_key);
+    }
+    if (NULL != keys) {
+        hbs_symbol_table_free(keys);
+    }
+    if (NULL != segments) {
+        hbs_symbol_table_free(segments);
+    }
+    hbs_parser_free(parser);
+    hbs_scanner_free(scanner);
+    return HBS_OK == result || HBS_ERROR_BUDGET == result
+        ? result : HBS_ERROR;
+}
+
+// Render the template using the template context. The input context contains
+// all context data and helpers (with the exception of the default helpers). If
+// the template contains expressions which don't match up to entries in the
+// context, those expressions are rendered as the empty string "". Since this
+// function cannot wait, it fails if a handler returns HBS_PENDING.
+HbsString* hbs_template_render(HbsTemplate* template,
+    HbsHandlers* handlers)
+{
+    HbsRender* render = hbs_render_new(template, handlers);
+    if (NULL == render) {
+        return NULL;
+    }
+
+    HbsString* result = NULL;
+    if (HBS_OK == hbs_render_resume(render)) {
+        result = hbs_render_take_output(render);
+    }
+
+    hbs_render_free(render);
+    return result;
+}
+
+HbsString* hbs_template_render_spans(HbsTemplate* template,
+    HbsHandlers* handlers, HbsSpanMap** span_map)
+{
+    HbsRender* render = hbs_render_new(template, handlers);
+    if (NULL == render) {
+        return NULL;
+    }
+
+    HbsString* result = NULL;
+    render->spans = hbs_span_map_new(template);
+    if (NULL != render->spans && HBS_OK == hbs_render_resume(render)) {
+        result = hbs_render_take_output(render);
+        *span_map = render->spans;
+        render->spans = NULL;
+    }
+
+    hbs_render_free(render);
+    return result;
+}
+
+// Each changed key is resolved once, as in the original render. If any of
+// them is structural, the template is rendered again instead.
+int hbs_template_rerender(HbsTemplate* template, HbsHandlers* handlers,
+    HbsString* output, HbsSpanMap* span_map, const size_t* changed,
+    size_t length)
+{
+    if (0 != hbs_template_acquire(template)) {
+        return 1;
+    }
+
+    int result = priv_rerender(template, handlers, output, span_map, changed,
+        length);
+    hbs_template_release(template);
+    return result;
+}
+
+HbsTemplate* hbs_template_specialize(HbsTemplate* template,
+    HbsHandlers* handlers)
+{
+    if (0 != hbs_template_acquire(template)) {
+        return NULL;
+    }
+
+    HbsNaryTree* tree = priv_specialize(template, handlers);
+    HbsTemplate* specialized = NULL != tree
+        ? hbs_template_from_components(tree, template->helpers, template->set)
+        : NULL;
+    hbs_template_release(template);
+    return specialized;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,7 @@
 //
 // CREATED:         12/29/2021
 //
-// LAST EDITED:     01/07/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -31,8 +31,8 @@
 ////
 
 #include <assert.h>
-#include <ctype.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -45,6 +45,83 @@ static const size_t CHAR_BUFFER_SIZE = 4096;
 static const size_t TOKEN_BUFFER_SIZE = 8;
 static const size_t PEEK_LENGTH = 2;
 
+// Classes of input bytes. Every byte maps to exactly one class through the
+// BYTE_CLASSES table, so classification doesn't depend on the locale.
+typedef enum HbsByteClass {
+    BYTE_TEXT,      // No special meaning
+    BYTE_NUL,       // '\0', which marks the end of the input
+    BYTE_BRACE,     // '{' or '}', the first half of a handlebars token
+    BYTE_WS,        // [ \t\n\v\f\r]
+    BYTE_HASH,      // '#'
+    BYTE_SLASH,     // '/'
+    BYTE_QUOTE,     // '"' or '\''
+    BYTE_PAREN,     // '(' or ')'
+    BYTE_GREATER,   // '>'
+    BYTE_CLASS_COUNT,
+} HbsByteClass;
+
+static const uint8_t BYTE_CLASSES[256] = {
+    ['\0'] = BYTE_NUL,
+    ['{'] = BYTE_BRACE, ['}'] = BYTE_BRACE,
+    [' '] = BYTE_WS, ['\t'] = BYTE_WS, ['\n'] = BYTE_WS, ['\v'] = BYTE_WS,
+    ['\f'] = BYTE_WS, ['\r'] = BYTE_WS,
+    ['#'] = BYTE_HASH,
+    ['/'] = BYTE_SLASH,
+    ['"'] = BYTE_QUOTE, ['\''] = BYTE_QUOTE,
+    ['('] = BYTE_PAREN, [')'] = BYTE_PAREN,
+    ['>'] = BYTE_GREATER,
+};
+
+// What the lexer does when it encounters a byte of a given class.
+typedef enum HbsLexAction {
+    LEX_TEXT,       // Append the byte to the current text token
+    LEX_BARS,       // "{{" or "}}", if the following byte is the same
+    LEX_WS,         // Whitespace token
+    LEX_HASH,       // Hash token
+    LEX_SLASH,      // Slash token
+    LEX_STRING,     // String literal token
+    LEX_PAREN,      // Open or close paren token
+    LEX_GREATER,    // Greater-than token
+    LEX_EOF,        // End of input
+} HbsLexAction;
+
+// The lexer's mode is a combination of these flags, which track the
+// ws_enabled and blocks_enabled members of the scanner.
+enum {
+    MODE_WS = 0x1,
+    MODE_BLOCKS = 0x2,
+    MODE_COUNT = 0x4,
+};
+
+// Transition table, indexed by mode and byte class. Supporting a new token is
+// a matter of adding a byte class and filling in its column here.
+static const uint8_t TRANSITIONS[MODE_COUNT][BYTE_CLASS_COUNT] = {
+    [0] = {
+        [BYTE_TEXT] = LEX_TEXT, [BYTE_NUL] = LEX_EOF, [BYTE_BRACE] = LEX_BARS,
+        [BYTE_WS] = LEX_TEXT, [BYTE_HASH] = LEX_TEXT, [BYTE_SLASH] = LEX_TEXT,
+        [BYTE_QUOTE] = LEX_TEXT, [BYTE_PAREN] = LEX_TEXT,
+        [BYTE_GREATER] = LEX_TEXT,
+    },
+    [MODE_WS] = {
+        [BYTE_TEXT] = LEX_TEXT, [BYTE_NUL] = LEX_EOF, [BYTE_BRACE] = LEX_BARS,
+        [BYTE_WS] = LEX_WS, [BYTE_HASH] = LEX_TEXT, [BYTE_SLASH] = LEX_TEXT,
+        [BYTE_QUOTE] = LEX_STRING, [BYTE_PAREN] = LEX_PAREN,
+        [BYTE_GREATER] = LEX_TEXT,
+    },
+    [MODE_BLOCKS] = {
+        [BYTE_TEXT] = LEX_TEXT, [BYTE_NUL] = LEX_EOF, [BYTE_BRACE] = LEX_BARS,
+        [BYTE_WS] = LEX_TEXT, [BYTE_HASH] = LEX_HASH, [BYTE_SLASH] = LEX_SLASH,
+        [BYTE_QUOTE] = LEX_TEXT, [BYTE_PAREN] = LEX_TEXT,
+        [BYTE_GREATER] = LEX_GREATER,
+    },
+    [MODE_WS | MODE_BLOCKS] = {
+        [BYTE_TEXT] = LEX_TEXT, [BYTE_NUL] = LEX_EOF, [BYTE_BRACE] = LEX_BARS,
+        [BYTE_WS] = LEX_WS, [BYTE_HASH] = LEX_HASH, [BYTE_SLASH] = LEX_SLASH,
+        [BYTE_QUOTE] = LEX_STRING, [BYTE_PAREN] = LEX_PAREN,
+        [BYTE_GREATER] = LEX_GREATER,
+    },
+};
+
 typedef struct HbsScanner {
     // If this flag is true, the scanner treats whitespace as a separate token
     // and generates HBS_TOKEN_WS instances. Otherwise, all whitespace is
@@ -52,18 +129,22 @@ typedef struct HbsScanner {
     bool ws_enabled;
 
     // As with whitespace tokens above, if this flag is true, tokens for
-    // handlebars block expressions are enabled ("#" and "/").
+    // handlebars block and partial expressions are enabled ("#", "/" and
+    // ">").
     bool blocks_enabled;
 
+    // Row of the transition table selected by the two flags above.
+    unsigned mode;
+
     // Provides a buffered, character-based input stream.
     CharStream stream;
 
-    // Keep track of the line and column of the cursor
-    int line_count;
-    int column_count;
-
     // Output stream for the tokens.
     TokenBuffer token_buffer;
+
+    // If non-zero, text outside of handlebars expressions is split into
+    // tokens of at most this many chars.
+    size_t max_text_length;
 } HbsScanner;
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -74,8 +155,7 @@ typedef struct HbsScanner {
 static void priv_move_token(HbsParseToken* dest, HbsParseToken* source) {
     dest->type = source->type;
     dest->string = source->string;
-    dest->line = source->line;
-    dest->column = source->column;
+    dest->offset = source->offset;
     memset(source, 0, sizeof(HbsParseToken));
 }
 
@@ -85,8 +165,7 @@ static inline void priv_init_token(HbsParseTokenType type,
     HbsParseToken* token, const HbsScanner* scanner)
 {
     token->type = type;
-    token->line = scanner->line_count;
-    token->column = scanner->column_count;
+    token->offset = char_stream_offset(&scanner->stream);
     token->string = NULL;
 }
 
@@ -120,6 +199,25 @@ static inline void priv_init_slash_token(HbsParseToken* token,
     const HbsScanner* scanner)
 { priv_init_token(HBS_TOKEN_SLASH, token, scanner); }
 
+static inline void priv_init_greater_token(HbsParseToken* token,
+    const HbsScanner* scanner)
+{ priv_init_token(HBS_TOKEN_GREATER, token, scanner); }
+
+static inline void priv_init_string_token(HbsParseToken* token,
+    const HbsScanner* scanner)
+{
+    priv_init_token(HBS_TOKEN_STRING, token, scanner);
+    token->string = hbs_string_new();
+}
+
+static inline void priv_init_open_paren_token(HbsParseToken* token,
+    const HbsScanner* scanner)
+{ priv_init_token(HBS_TOKEN_OPEN_PAREN, token, scanner); }
+
+static inline void priv_init_close_paren_token(HbsParseToken* token,
+    const HbsScanner* scanner)
+{ priv_init_token(HBS_TOKEN_CLOSE_PAREN, token, scanner); }
+
 static inline void priv_init_eof_token(HbsParseToken* token,
     const HbsScanner* scanner)
 { priv_init_token(HBS_TOKEN_EOF, token, scanner); }
@@ -130,45 +228,41 @@ static inline void priv_init_eof_token(HbsParseToken* token,
 
 // Obtain the next char from the buffered stream, which could result in reading
 // more data from the stream.
-static char priv_next_char(HbsScanner* scanner) {
-    char result = char_stream_next(&scanner->stream);
-    if ('\n' == result) {
-        scanner->line_count += 1;
-        scanner->column_count = 0;
-    } else {
-        scanner->column_count += 1;
-    }
-
-    return result;
+static inline char priv_next_char(HbsScanner* scanner)
+{ return char_stream_next(&scanner->stream); }
+
+// Append <current> to the string of <token>, which may have failed to
+// allocate it. Returns non-zero if memory can't be allocated.
+static inline int priv_append_char(HbsParseToken* token, char current) {
+    return NULL == token->string
+        || 0 != hbs_string_append_buffer(token->string, &current, 1);
 }
 
-static bool priv_is_ws_token(const CharStream* stream)
-{ return isspace(char_stream_peek(stream, 0)); }
-
-static void priv_consume_ws_token(HbsScanner* scanner) {
+static int priv_consume_ws_token(HbsScanner* scanner) {
     HbsParseToken* token = token_buffer_reserve(&scanner->token_buffer);
+    if (NULL == token) {
+        return 1;
+    }
+
     priv_init_ws_token(token, scanner);
 
     char current = char_stream_peek(&scanner->stream, 0);
-    while (isspace(current)) {
-        char fragment[] = {current, '\0'};
-        hbs_string_append_str(token->string, fragment);
+    while (BYTE_WS == BYTE_CLASSES[(unsigned char)current]) {
+        if (0 != priv_append_char(token, current)) {
+            return 1;
+        }
         priv_next_char(scanner);
         current = char_stream_peek(&scanner->stream, 0);
     }
+    return 0;
 }
 
-// Return true if the next token in the stream is
-static bool priv_is_handlebars_token(const CharStream* stream) {
-    char current = char_stream_peek(stream, 0);
-    char next = char_stream_peek(stream, 1);
-    return ('{' == current || '}' == current) && current == next;
-}
-
-static void priv_consume_handlebars_token(HbsScanner* scanner) {
-    // Have to consume two tokens from the stream.
-    char current = char_stream_peek(&scanner->stream, 0);
+static int priv_consume_handlebars_token(HbsScanner* scanner, char current) {
     HbsParseToken* token = token_buffer_reserve(&scanner->token_buffer);
+    if (NULL == token) {
+        return 1;
+    }
+
     switch (current) {
     case '{': priv_init_open_bars_token(token, scanner); break;
     case '}': priv_init_close_bars_token(token, scanner); break;
@@ -176,72 +270,162 @@ static void priv_consume_handlebars_token(HbsScanner* scanner) {
     }
 
     // Have to consume the chars in the token after initializing the token,
-    // since token initialization captures the line/column counts.
+    // since token initialization captures the offset.
     priv_next_char(scanner);
     priv_next_char(scanner);
+    return 0;
 }
 
-static bool priv_is_hash_token(const CharStream* stream)
-{ return char_stream_peek(stream, 0) == '#'; }
-
-static void priv_consume_hash_token(HbsScanner* scanner) {
+static int priv_consume_hash_token(HbsScanner* scanner) {
     HbsParseToken* token = token_buffer_reserve(&scanner->token_buffer);
+    if (NULL == token) {
+        return 1;
+    }
+
     priv_init_hash_token(token, scanner);
     priv_next_char(scanner);
+    return 0;
 }
 
-static bool priv_is_slash_token(const CharStream* stream)
-{ return char_stream_peek(stream, 0) == '/'; }
-
-static void priv_consume_slash_token(HbsScanner* scanner) {
+static int priv_consume_slash_token(HbsScanner* scanner) {
     HbsParseToken* token = token_buffer_reserve(&scanner->token_buffer);
+    if (NULL == token) {
+        return 1;
+    }
+
     priv_init_slash_token(token, scanner);
     priv_next_char(scanner);
+    return 0;
 }
 
-static bool priv_is_eof_token(const CharStream* stream)
-{ return '\0' == char_stream_peek(stream, 0); }
+static int priv_consume_greater_token(HbsScanner* scanner) {
+    HbsParseToken* token = token_buffer_reserve(&scanner->token_buffer);
+    if (NULL == token) {
+        return 1;
+    }
 
-static void priv_consume_eof_token(HbsScanner* scanner) {
+    priv_init_greater_token(token, scanner);
+    priv_next_char(scanner);
+    return 0;
+}
+
+static int priv_consume_paren_token(HbsScanner* scanner, char current) {
     HbsParseToken* token = token_buffer_reserve(&scanner->token_buffer);
-    priv_init_eof_token(token, scanner);
+    if (NULL == token) {
+        return 1;
+    }
+
+    switch (current) {
+    case '(': priv_init_open_paren_token(token, scanner); break;
+    case ')': priv_init_close_paren_token(token, scanner); break;
+    default: assert(0); // Programmer's error.
+    }
+    priv_next_char(scanner);
+    return 0;
 }
 
-static int priv_iterate_lexer(HbsScanner* scanner) {
-    int result = 0;
-    CharStream* stream = &scanner->stream;
-    if (priv_is_handlebars_token(stream)) {
-        priv_consume_handlebars_token(scanner);
-        result = 1;
-    } else if (scanner->ws_enabled && priv_is_ws_token(stream)) {
-        priv_consume_ws_token(scanner);
-        result = 1;
-    } else if (scanner->blocks_enabled && priv_is_hash_token(stream)) {
-        priv_consume_hash_token(scanner);
-        result = 1;
-    } else if (scanner->blocks_enabled && priv_is_slash_token(stream)) {
-        priv_consume_slash_token(scanner);
-        result = 1;
-    } else if (priv_is_eof_token(stream)) {
-        priv_consume_eof_token(scanner);
-        result = 1;
+// A string literal extends to the next unescaped quote matching <quote>, or
+// the end of the input. The token's string is the literal as written, quotes
+// and escapes included, so that its length matches the input.
+static int priv_consume_string_token(HbsScanner* scanner, char quote) {
+    HbsParseToken* token = token_buffer_reserve(&scanner->token_buffer);
+    if (NULL == token) {
+        return 1;
     }
 
-    return result;
+    priv_init_string_token(token, scanner);
+    if (0 != priv_append_char(token, quote)) {
+        return 1;
+    }
+    priv_next_char(scanner);
+
+    char current = char_stream_peek(&scanner->stream, 0);
+    while ('\0' != current) {
+        if (0 != priv_append_char(token, current)) {
+            return 1;
+        }
+        priv_next_char(scanner);
+        if (quote == current) {
+            break;
+        } else if ('\\' == current) {
+            current = char_stream_peek(&scanner->stream, 0);
+            if ('\0' == current) {
+                break;
+            } else if (0 != priv_append_char(token, current)) {
+                return 1;
+            }
+            priv_next_char(scanner);
+        }
+        current = char_stream_peek(&scanner->stream, 0);
+    }
+    return 0;
+}
+
+static int priv_consume_eof_token(HbsScanner* scanner) {
+    HbsParseToken* token = token_buffer_reserve(&scanner->token_buffer);
+    if (NULL == token) {
+        return 1;
+    }
+
+    priv_init_eof_token(token, scanner);
+    return 0;
+}
+
+// Generate the token for <action>, which begins with <current>. Returns
+// non-zero if memory can't be allocated for the token.
+static int priv_consume_token(HbsScanner* scanner, HbsLexAction action,
+    char current)
+{
+    switch (action) {
+    case LEX_BARS: return priv_consume_handlebars_token(scanner, current);
+    case LEX_WS: return priv_consume_ws_token(scanner);
+    case LEX_HASH: return priv_consume_hash_token(scanner);
+    case LEX_SLASH: return priv_consume_slash_token(scanner);
+    case LEX_STRING: return priv_consume_string_token(scanner, current);
+    case LEX_PAREN: return priv_consume_paren_token(scanner, current);
+    case LEX_GREATER: return priv_consume_greater_token(scanner);
+    case LEX_EOF: return priv_consume_eof_token(scanner);
+    default: assert(0); return 1; // Programmer's error.
+    }
 }
 
-// Fill the peek buffer with tokens.
+// Fill the peek buffer with tokens. Each byte costs one lookup in the byte
+// class table and one in the transition table for the current mode. Any run
+// of bytes which don't begin a token is collected into a text token. Returns
+// non-zero if memory can't be allocated for a token.
 static int priv_fill_peek_buffer(HbsScanner* scanner) {
     // This routine generates at least one token on every iteration.
+    const uint8_t* transitions = TRANSITIONS[scanner->mode];
+    CharStream* stream = &scanner->stream;
     HbsParseToken* text_token = NULL;
-    while (!priv_iterate_lexer(scanner)) {
+    while (true) {
+        const char current = char_stream_peek(stream, 0);
+        const uint8_t byte_class = BYTE_CLASSES[(unsigned char)current];
+        HbsLexAction action = transitions[byte_class];
+        if (LEX_BARS == action && current != char_stream_peek(stream, 1)) {
+            action = LEX_TEXT; // A single brace is just text.
+        }
+
+        if (LEX_TEXT != action) {
+            return priv_consume_token(scanner, action, current);
+        }
+
         if (NULL == text_token) {
             text_token = token_buffer_reserve(&scanner->token_buffer);
+            if (NULL == text_token) {
+                return 1;
+            }
             priv_init_text_token(text_token, scanner);
         }
 
-        char fragment[] = {priv_next_char(scanner), '\0'};
-        hbs_string_append_str(text_token->string, fragment);
+        if (0 != priv_append_char(text_token, current)) {
+            return 1;
+        }
+        priv_next_char(scanner);
+        if (!scanner->ws_enabled && 0 != scanner->max_text_length
+            && text_token->string->length >= scanner->max_text_length) {
+            break;
+        }
     }
 
     return 0;
@@ -259,14 +443,21 @@ HbsScanner* hbs_scanner_new(HbsInputContext* input_context) {
     }
 
     memset(scanner, 0, sizeof(HbsScanner));
-    scanner->line_count = 1;
-    token_buffer_init(&scanner->token_buffer, TOKEN_BUFFER_SIZE);
-    char_stream_init(&scanner->stream, CHAR_BUFFER_SIZE, PEEK_LENGTH,
-        input_context);
+    if (0 != token_buffer_init(&scanner->token_buffer, TOKEN_BUFFER_SIZE)
+        || 0 != char_stream_init(&scanner->stream, CHAR_BUFFER_SIZE,
+            PEEK_LENGTH, input_context)) {
+        hbs_scanner_free(scanner);
+        return NULL;
+    }
 
     return scanner;
 }
 
+// Compute the line and column of <offset>, for diagnostics.
+int hbs_scanner_locate(const HbsScanner* scanner, size_t offset, size_t* line,
+    size_t* column)
+{ return char_stream_locate(&scanner->stream, offset, line, column); }
+
 // Free internal memory assocaited with the scanner.
 void hbs_scanner_free(HbsScanner* scanner) {
     char_stream_release(&scanner->stream);
@@ -280,25 +471,40 @@ void hbs_scanner_free(HbsScanner* scanner) {
 // parser to notify it of whitespace. The same goes for the octothorpe and
 // forward slash symbols. This design choice was aimed at simplifying the logic
 // of the scanner at the expense of a slightly more complex interface.
-void hbs_scanner_disable_hbs_tokens(HbsScanner* scanner)
-{ scanner->ws_enabled = false; scanner->blocks_enabled = false; }
-void hbs_scanner_enable_hbs_tokens(HbsScanner* scanner)
-{ scanner->ws_enabled = true; scanner->blocks_enabled = true; }
+void hbs_scanner_disable_hbs_tokens(HbsScanner* scanner) {
+    scanner->ws_enabled = false;
+    scanner->blocks_enabled = false;
+    scanner->mode = 0;
+}
+
+void hbs_scanner_enable_hbs_tokens(HbsScanner* scanner) {
+    scanner->ws_enabled = true;
+    scanner->blocks_enabled = true;
+    scanner->mode = MODE_WS | MODE_BLOCKS;
+}
+
+// Limit the length of text tokens generated outside of handlebars expressions,
+// so that memory usage doesn't depend on the length of the input. Zero (the
+// default) means no limit.
+void hbs_scanner_set_max_text_length(HbsScanner* scanner, size_t length)
+{ scanner->max_text_length = length; }
 
 // Populate <token> with the next token from the stream. Return the number of
-// tokens processed (i.e. 1 for a successful scan).
+// tokens processed (i.e. 1 for a successful scan). If the scan fails, <token>
+// is a HBS_TOKEN_NULL.
 // Token table:
 int hbs_scanner_next_symbol(HbsScanner* scanner, HbsParseToken* token) {
     int result = 0;
+    priv_init_token(HBS_TOKEN_NULL, token, scanner);
     if (0 < scanner->token_buffer.length) {
         HbsParseToken* next = token_buffer_dequeue(&scanner->token_buffer);
         priv_move_token(token, next);
         return 1;
     }
 
-    // Ensure the peek buffer is full before dequeueing.
+    // Ensure the peek buffer is full before dequeueing. A text token may have
+    // been completed even if a token following it couldn't be allocated.
     priv_fill_peek_buffer(scanner);
-
     if (0 < scanner->token_buffer.length) {
         HbsParseToken* next = token_buffer_dequeue(&scanner->token_buffer);
         priv_move_token(token, next);
@@ -309,14 +515,27 @@ int hbs_scanner_next_symbol(HbsScanner* scanner, HbsParseToken* token) {
 }
 
 // Peek at the type of the next token
-HbsParseTokenType hbs_scanner_peek(HbsScanner* scanner) {
-    HbsParseToken* top = token_buffer_peek(&scanner->token_buffer);
-    if (NULL == top) {
-        priv_fill_peek_buffer(scanner);
-        top = token_buffer_peek(&scanner->token_buffer);
+HbsParseTokenType hbs_scanner_peek(HbsScanner* scanner)
+{ return hbs_scanner_peek_n(scanner, 0); }
+
+// Peek at the type of the token <n> positions ahead of the next token. The
+// token buffer grows as necessary, so there's no limit on <n>. Tokens are
+// scanned in the current mode (see hbs_scanner_enable_hbs_tokens()).
+HbsParseTokenType hbs_scanner_peek_n(HbsScanner* scanner, size_t n) {
+    TokenBuffer* buffer = &scanner->token_buffer;
+    while (buffer->length <= n) {
+        // Nothing follows the end of the input.
+        if (0 < buffer->length && HBS_TOKEN_EOF
+            == token_buffer_at(buffer, buffer->length - 1)->type) {
+            return HBS_TOKEN_EOF;
+        }
+
+        if (0 != priv_fill_peek_buffer(scanner) && buffer->length <= n) {
+            return HBS_TOKEN_NULL;
+        }
     }
 
-    return top->type;
+    return token_buffer_at(buffer, n)->type;
 }
 
 // Return a string describing the Parser token type (for debugging purposes)
@@ -330,6 +549,18 @@ const char* hbs_token_to_string(HbsParseTokenType type) {
         return "HBS_TOKEN_TEXT";
     case HBS_TOKEN_WS:
         return "HBS_TOKEN_WS";
+    case HBS_TOKEN_HASH:
+        return "HBS_TOKEN_HASH";
+    case HBS_TOKEN_SLASH:
+        return "HBS_TOKEN_SLASH";
+    case HBS_TOKEN_GREATER:
+        return "HBS_TOKEN_GREATER";
+    case HBS_TOKEN_STRING:
+        return "HBS_TOKEN_STRING";
+    case HBS_TOKEN_OPEN_PAREN:
+        return "HBS_TOKEN_OPEN_PAREN";
+    case HBS_TOKEN_CLOSE_PAREN:
+        return "HBS_TOKEN_CLOSE_PAREN";
     case HBS_TOKEN_EOF:
         return "HBS_TOKEN_EOF";
     default:
@@ -340,7 +571,8 @@ const char* hbs_token_to_string(HbsParseTokenType type) {
 // Release internal memory held by <token>. This allows the caller to manage
 // the memory of <token> itself.
 void hbs_token_release(HbsParseToken* token) {
-    if (HBS_TOKEN_TEXT == token->type || HBS_TOKEN_WS == token->type) {
+    if ((HBS_TOKEN_TEXT == token->type || HBS_TOKEN_WS == token->type
+            || HBS_TOKEN_STRING == token->type) && NULL != token->string) {
         hbs_string_free(token->string);
     }
 
@@ -7,7 +7,7 @@
 //
 // CREATED:         12/28/2021
 //
-// LAST EDITED:     01/07/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -33,6 +33,8 @@
 #ifndef HANDLEBARS_SCANNER_H
 #define HANDLEBARS_SCANNER_H
 
+#include <stddef.h>
+
 // Opaque typedef of the HbsScanner type.
 typedef struct HbsScanner HbsScanner;
 
@@ -60,6 +62,15 @@ typedef enum HbsParseTokenType {
     // unless explicitly enabled by the parser.
     HBS_TOKEN_HASH,         // "#"
     HBS_TOKEN_SLASH,        // "/"
+    HBS_TOKEN_GREATER,      // ">"
+
+    // String literal within a handlebars expression, e.g. "iso" or 'iso'.
+    // The token's string includes the quotes.
+    HBS_TOKEN_STRING,
+
+    // Parentheses around a subexpression, e.g. "(lower name)".
+    HBS_TOKEN_OPEN_PAREN,   // "("
+    HBS_TOKEN_CLOSE_PAREN,  // ")"
 
     HBS_TOKEN_EOF, // End of file (or stream)
 } HbsParseTokenType;
@@ -68,10 +79,9 @@ typedef enum HbsParseTokenType {
 typedef struct HbsParseToken {
     HbsParseTokenType type;      // Type of the token
 
-    // The line number and column number in the input that marks the start of
-    // the token.
-    int line;
-    int column;
+    // The offset in the input of the start of the token. The corresponding
+    // line and column can be obtained with hbs_scanner_locate().
+    size_t offset;
 
     // String representing
     HbsString* string;
@@ -89,13 +99,33 @@ HbsScanner* hbs_scanner_new(HbsInputContext* input_context);
 void hbs_scanner_disable_hbs_tokens(HbsScanner* scanner);
 void hbs_scanner_enable_hbs_tokens(HbsScanner* scanner);
 
+// Limit the length of text tokens generated outside of handlebars expressions,
+// so that memory usage doesn't depend on the length of the input. Longer runs
+// of text are split into multiple tokens. Zero (the default) means no limit.
+void hbs_scanner_set_max_text_length(HbsScanner* scanner, size_t length);
+
 // Populate <token> with the next token from the stream. Return the number of
-// tokens processed (i.e. 1 for a successful scan).
+// tokens processed (i.e. 1 for a successful scan). If memory can't be
+// allocated for the token, zero is returned and <token> is a HBS_TOKEN_NULL.
 int hbs_scanner_next_symbol(HbsScanner* scanner, HbsParseToken* token);
 
 // Peek at the type of the next token
 HbsParseTokenType hbs_scanner_peek(HbsScanner* scanner);
 
+// Peek at the type of the token <n> positions ahead of the next token, so that
+// hbs_scanner_peek_n(scanner, 0) is equivalent to hbs_scanner_peek(scanner).
+// There's no limit on <n>. Note that tokens are scanned in the mode that's
+// current when they're peeked at. Returns HBS_TOKEN_EOF past the end of the
+// input, or HBS_TOKEN_NULL if memory can't be allocated for the tokens.
+HbsParseTokenType hbs_scanner_peek_n(HbsScanner* scanner, size_t n);
+
+// Compute the line (starting at 1) and column (starting at 0) of <offset>, for
+// diagnostics. Since the scanner discards input as it goes, only offsets near
+// the most recently scanned token can be located. Returns non-zero if the
+// offset can't be located.
+int hbs_scanner_locate(const HbsScanner* scanner, size_t offset, size_t* line,
+    size_t* column);
+
 // Free internal memory assocaited with the scanner.
 void hbs_scanner_free(HbsScanner* scanner);
 
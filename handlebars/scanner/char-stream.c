@@ -7,7 +7,7 @@
 //
 // CREATED:         12/30/2021
 //
-// LAST EDITED:     01/06/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -31,6 +31,8 @@
 ////
 
 #include <assert.h>
+#include <errno.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -41,24 +43,57 @@
 // Private API
 ////
 
-static void priv_fill_buffer_with_peek_shift(CharStream* stream) {
-    for (size_t i = 0; i < stream->peek_length; ++i) {
-        stream->buffer[i] = stream->buffer[stream->index + i];
+// Count the newlines in the first <length> chars of the buffer, storing the
+// index of the last one in <last> (if there are any).
+static size_t priv_count_newlines(const CharStream* stream, size_t length,
+    size_t* last)
+{
+    size_t count = 0;
+    const char* cursor = stream->buffer;
+    const char* end = stream->buffer + length;
+    while (NULL != (cursor = memchr(cursor, '\n', end - cursor))) {
+        *last = cursor - stream->buffer;
+        count += 1;
+        cursor += 1;
+    }
+
+    return count;
+}
+
+// Discard the chars behind the cursor, moving the rest to the front of the
+// buffer. The newlines in the discarded chars are counted here, so that the
+// line and column of later offsets can still be computed.
+static void priv_compact_buffer(CharStream* stream) {
+    size_t last = SIZE_MAX;
+    stream->base_newlines += priv_count_newlines(stream, stream->index, &last);
+    if (SIZE_MAX != last) {
+        stream->base_last_newline = stream->base + last;
     }
 
-    stream->level = stream->input_context->read(
-        stream->input_context->data, stream->buffer + stream->peek_length,
-        stream->capacity - stream->peek_length - 1);
+    stream->base += stream->index;
+    stream->level -= stream->index;
+    memmove(stream->buffer, stream->buffer + stream->index, stream->level);
     stream->index = 0;
-    stream->buffer[stream->level + stream->peek_length] = '\0';
 }
 
+// Read more input into the buffer. Consumed chars are kept around until the
+// buffer is half full, so that recent offsets can be located for diagnostics.
 static void priv_fill_buffer(CharStream* stream) {
-    stream->level = stream->input_context->read(
-        stream->input_context->data, stream->buffer,
-        stream->capacity - 1);
-    stream->index = 0;
-    stream->buffer[stream->level] = '\0';
+    if (stream->capacity - 1 - stream->level < stream->capacity / 2) {
+        priv_compact_buffer(stream);
+    }
+
+    stream->level += stream->input_context->read(
+        stream->input_context->data, stream->buffer + stream->level,
+        stream->capacity - 1 - stream->level);
+
+    // Pad the buffer with NULs, so that peeking past the end of the input
+    // returns the end-of-input char.
+    size_t pad = stream->capacity - stream->level;
+    if (pad > stream->peek_length + 1) {
+        pad = stream->peek_length + 1;
+    }
+    memset(stream->buffer + stream->level, 0, pad);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -68,21 +103,23 @@ static void priv_fill_buffer(CharStream* stream) {
 // Initialize a CharStream at <stream> with a peek buffer of <peek_buffer>,
 // that is, allow peeking at chars up to `<peek_buffer> - 1` positions ahead of
 // the cursor. Will assert if <peek_length> is greater than <capacity>.
-void char_stream_init(CharStream* stream, size_t capacity, size_t peek_length,
+int char_stream_init(CharStream* stream, size_t capacity, size_t peek_length,
     HbsInputContext* input_context)
 {
     assert(peek_length <= capacity);
     memset(stream, 0, sizeof(CharStream));
     stream->buffer = malloc(capacity);
     if (NULL == stream->buffer) {
-        return;
+        return ENOMEM;
     }
 
     memset(stream->buffer, 0, capacity);
     stream->input_context = input_context;
+    stream->base_last_newline = SIZE_MAX;
     stream->peek_length = peek_length;
     stream->capacity = capacity;
     priv_fill_buffer(stream);
+    return 0;
 }
 
 // Release internal memory held by the CharStream.
@@ -93,8 +130,13 @@ void char_stream_release(CharStream* stream)
 // an error occurs in reading.
 char char_stream_next(CharStream* stream) {
     // May need to read more from the input source.
-    if (stream->index >= stream->level - stream->peek_length) {
-        priv_fill_buffer_with_peek_shift(stream);
+    if (stream->index + stream->peek_length >= stream->level) {
+        priv_fill_buffer(stream);
+    }
+
+    // The cursor doesn't advance past the end of the input.
+    if (stream->index >= stream->level) {
+        return '\0';
     }
 
     return stream->buffer[stream->index++];
@@ -108,4 +150,29 @@ char char_stream_peek(const CharStream* stream, size_t offset) {
     return stream->buffer[stream->index + offset];
 }
 
+// Return the offset in the input of the char that will be returned by the
+// next call to char_stream_next().
+size_t char_stream_offset(const CharStream* stream)
+{ return stream->base + stream->index; }
+
+// Compute the line and column of the char at <offset> in the input. The
+// newlines in the current buffer are counted here, on demand.
+int char_stream_locate(const CharStream* stream, size_t offset, size_t* line,
+    size_t* column)
+{
+    if (offset < stream->base || offset > stream->base + stream->level) {
+        return 1;
+    }
+
+    size_t last = SIZE_MAX;
+    size_t newlines = priv_count_newlines(stream, offset - stream->base,
+        &last);
+    size_t last_newline = SIZE_MAX != last
+        ? stream->base + last : stream->base_last_newline;
+
+    *line = 1 + stream->base_newlines + newlines;
+    *column = SIZE_MAX != last_newline ? offset - last_newline - 1 : offset;
+    return 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
@@ -9,7 +9,7 @@
 //
 // CREATED:         12/30/2021
 //
-// LAST EDITED:     01/06/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -50,12 +50,21 @@ typedef struct CharStream {
     size_t level;
     size_t peek_length;
     size_t capacity;
+
+    // Offset in the input of buffer[0]. The number of newlines preceding it,
+    // and the offset of the last one (or SIZE_MAX if there are none). These
+    // are only updated when the buffer is refilled, so that line and column
+    // numbers cost nothing until they're asked for.
+    size_t base;
+    size_t base_newlines;
+    size_t base_last_newline;
 } CharStream;
 
 // Initialize a CharStream at <stream> with a peek buffer of <peek_buffer>,
 // that is, allow peeking at chars up to `<peek_buffer> - 1` positions ahead of
-// the cursor. Will assert if <peek_length> is greater than <capacity>.
-void char_stream_init(CharStream* stream, size_t capacity, size_t peek_buffer,
+// the cursor. Will assert if <peek_length> is greater than <capacity>. Returns
+// ENOMEM if the buffer can't be allocated.
+int char_stream_init(CharStream* stream, size_t capacity, size_t peek_buffer,
     HbsInputContext* input_context);
 
 // Release internal memory held by the CharStream.
@@ -70,6 +79,17 @@ char char_stream_next(CharStream* stream);
 // above).
 char char_stream_peek(const CharStream* stream, size_t offset);
 
+// Return the offset in the input of the char that will be returned by the
+// next call to char_stream_next().
+size_t char_stream_offset(const CharStream* stream);
+
+// Compute the line (starting at 1) and column (starting at 0) of the char at
+// <offset> in the input. Only offsets within the current buffer (i.e. near
+// the cursor) can be located, since earlier input has been discarded. Returns
+// non-zero if <offset> can't be located.
+int char_stream_locate(const CharStream* stream, size_t offset, size_t* line,
+    size_t* column);
+
 #endif // HANDLEBARS_CHAR_STREAM_H
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,7 @@
 //
 // CREATED:         12/30/2021
 //
-// LAST EDITED:     01/07/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -30,7 +30,6 @@
 // IN THE SOFTWARE.
 ////
 
-#include <assert.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
@@ -38,34 +37,77 @@
 #include <handlebars/scanner.h>
 #include <handlebars/scanner/token-buffer.h>
 
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+// Double the capacity of the buffer. The tokens are unwrapped into the front
+// of the new array, so that bottom is zero afterwards.
+static int priv_token_buffer_grow(TokenBuffer* buffer) {
+    size_t capacity = 2 * buffer->capacity;
+    HbsParseToken* tokens = calloc(capacity, sizeof(HbsParseToken));
+    if (NULL == tokens) {
+        return ENOMEM;
+    }
+
+    const size_t mask = buffer->capacity - 1;
+    for (size_t i = 0; i < buffer->length; ++i) {
+        tokens[i] = buffer->buffer[(buffer->bottom + i) & mask];
+    }
+
+    free(buffer->buffer);
+    buffer->buffer = tokens;
+    buffer->capacity = capacity;
+    buffer->bottom = 0;
+    buffer->top = buffer->length;
+    return 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Public API
 ////
 
-// Initialize a TokenBuffer at <buffer>.
+// Initialize a TokenBuffer at <buffer>. The capacity is rounded up to a power
+// of two.
 int token_buffer_init(TokenBuffer* buffer, size_t buffer_length) {
     memset(buffer, 0, sizeof(TokenBuffer));
-    buffer->buffer = calloc(buffer_length, sizeof(HbsParseToken));
+    size_t capacity = 1;
+    while (capacity < buffer_length) {
+        capacity <<= 1;
+    }
+
+    buffer->buffer = calloc(capacity, sizeof(HbsParseToken));
     if (NULL == buffer->buffer) {
         return ENOMEM;
     }
 
-    buffer->capacity = buffer_length;
+    buffer->capacity = capacity;
     return 0;
 }
 
-// Release memory held internally by a TokenBuffer.
-void token_buffer_release(TokenBuffer* buffer)
-{ free(buffer->buffer); }
+// Release memory held internally by a TokenBuffer, including any tokens which
+// haven't been dequeued.
+void token_buffer_release(TokenBuffer* buffer) {
+    HbsParseToken* token = NULL;
+    while (NULL != (token = token_buffer_dequeue(buffer))) {
+        hbs_token_release(token);
+    }
+
+    free(buffer->buffer);
+}
 
 // Reserve a new slot in the ring buffer and return a pointer to it. This
-// allows in-place construction of HbsParseTokens. Since we aim to set the size
-// of this buffer never to overflow, just assert if overflow is detected.
+// allows in-place construction of HbsParseTokens. The buffer grows if it's
+// full, which invalidates pointers previously returned from this buffer.
 HbsParseToken* token_buffer_reserve(TokenBuffer* buffer) {
-    assert(buffer->length < buffer->capacity);
+    if (buffer->length == buffer->capacity
+        && 0 != priv_token_buffer_grow(buffer)) {
+        return NULL;
+    }
+
     HbsParseToken* token = &buffer->buffer[buffer->top];
     buffer->length += 1;
-    buffer->top = (buffer->top + 1) % buffer->capacity;
+    buffer->top = (buffer->top + 1) & (buffer->capacity - 1);
     return token;
 }
 
@@ -78,7 +120,7 @@ HbsParseToken* token_buffer_dequeue(TokenBuffer* buffer) {
 
     HbsParseToken* token = &buffer->buffer[buffer->bottom];
     buffer->length -= 1;
-    buffer->bottom = (buffer->bottom + 1) % buffer->capacity;
+    buffer->bottom = (buffer->bottom + 1) & (buffer->capacity - 1);
     return token;
 }
 
@@ -91,4 +133,14 @@ HbsParseToken* token_buffer_peek(TokenBuffer* buffer) {
     return &buffer->buffer[buffer->bottom];
 }
 
+// Peek at the token <index> positions from the bottom of the buffer, or NULL
+// if there aren't that many tokens.
+HbsParseToken* token_buffer_at(TokenBuffer* buffer, size_t index) {
+    if (index >= buffer->length) {
+        return NULL;
+    }
+
+    return &buffer->buffer[(buffer->bottom + index) & (buffer->capacity - 1)];
+}
+
 ///////////////////////////////////////////////////////////////////////////////
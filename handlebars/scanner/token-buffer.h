@@ -7,7 +7,7 @@
 //
 // CREATED:         12/30/2021
 //
-// LAST EDITED:     01/07/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -34,22 +34,25 @@
 #define HANDLEBARS_TOKEN_BUFFER_H
 
 typedef struct TokenBuffer {
-    size_t capacity;        // Total capacity of the buffer
+    size_t capacity;        // Total capacity of the buffer (a power of two)
     size_t length;          // Number of items currently in the buffer
     size_t top;             // Array index pointing to current "top"
     size_t bottom;          // Array index pointing to current "bottom"
     HbsParseToken* buffer;  // Array of HbsParseTokens.
 } TokenBuffer;
 
-// Initialize a TokenBuffer at <buffer>.
+// Initialize a TokenBuffer at <buffer>. The capacity is rounded up to a power
+// of two.
 int token_buffer_init(TokenBuffer* buffer, size_t buffer_length);
 
-// Release memory held internally by a TokenBuffer.
+// Release memory held internally by a TokenBuffer, including any tokens which
+// haven't been dequeued.
 void token_buffer_release(TokenBuffer* buffer);
 
 // Reserve a new slot in the ring buffer and return a pointer to it. This
-// allows in-place construction of HbsParseTokens. Since we aim to set the size
-// of this buffer never to overflow, just assert if overflow is detected.
+// allows in-place construction of HbsParseTokens. The buffer grows if it's
+// full, which invalidates pointers previously returned from this buffer.
+// Returns NULL if memory can't be allocated.
 HbsParseToken* token_buffer_reserve(TokenBuffer* buffer);
 
 // De-queue a token from the bottom of the buffer (return a pointer to it) and
@@ -59,6 +62,10 @@ HbsParseToken* token_buffer_dequeue(TokenBuffer* buffer);
 // Peek at the token that would be popped with a call to _dequeue().
 HbsParseToken* token_buffer_peek(TokenBuffer* buffer);
 
+// Peek at the token <index> positions from the bottom of the buffer (so that
+// zero is equivalent to _peek()), or NULL if there aren't that many tokens.
+HbsParseToken* token_buffer_at(TokenBuffer* buffer, size_t index);
+
 #endif // HANDLEBARS_TOKEN_BUFFER_H
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,355 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            span-map.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Records where the values of expressions were rendered, so
+//                  that the output can be patched when they change.
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+////
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <handlebars/handlebars.h>
+#include <handlebars/nary-tree.h>
+#include <handlebars/parser.h>
+#include <handlebars/span-map.h>
+#include <handlebars/symbol-table.h>
+#include <handlebars/template.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static void priv_mark_structural(HbsSpanMap* map, size_t slot) {
+    if (slot < map->key_count) {
+        map->keys[slot].structural = true;
+    }
+}
+
+// Find the keys whose values can be patched: those which are only used by
+// expressions relative to the top level of the template. Keys of blocks and
+// helper arguments, and keys resolved within the context of a block, are
+// structural. Partials whose names are computed at render time use keys the
+// map knows nothing about, so they make every key structural.
+static void priv_classify_keys(HbsSpanMap* map, const HbsTemplate* template)
+{
+    HbsNaryTreeIter iterator;
+    hbs_nary_tree_iter_init(&iterator, template->components);
+    HbsNaryNode* root = hbs_nary_tree_get_root(template->components);
+    HbsNaryNode* element = NULL;
+    size_t depth = 0;
+    for (size_t position = 0;
+         root != (element = hbs_nary_tree_iter_next(&iterator));
+         ++position) {
+        const HbsComponent* component = hbs_nary_node_get_data(element);
+        switch (component->type) {
+        case HBS_COMPONENT_EXPRESSION:
+            if (depth != component->path.depth) {
+                priv_mark_structural(map, component->key_slot);
+            } else if (HBS_SPAN_NONE
+                       == map->keys[component->key_slot].component) {
+                map->keys[component->key_slot].component = position;
+            }
+            break;
+
+        case HBS_COMPONENT_BLOCK_OPEN:
+            priv_mark_structural(map, component->key_slot);
+            depth += 1;
+            break;
+
+        case HBS_COMPONENT_BLOCK_CLOSE:
+            depth -= 1;
+            break;
+
+        case HBS_COMPONENT_HELPER:
+            for (size_t i = 0; i < component->step_count; ++i) {
+                if (HBS_STEP_KEY == component->steps[i].type) {
+                    priv_mark_structural(map, hbs_symbol_table_find(
+                            template->keys, component->steps[i].key));
+                }
+            }
+            break;
+
+        case HBS_COMPONENT_PARTIAL:
+            for (size_t i = 0; i < map->key_count; ++i) {
+                map->keys[i].structural = true;
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+static int priv_compare_indices(const void* first, const void* second) {
+    const size_t a = *(const size_t*)first;
+    const size_t b = *(const size_t*)second;
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+// Collect the indices of the spans of the changed keys, in order.
+static size_t* priv_changed_spans(const HbsSpanMap* map, size_t* length) {
+    *length = 0;
+    for (size_t i = 0; i < map->key_count; ++i) {
+        if (!map->keys[i].changed) {
+            continue;
+        }
+        for (size_t j = map->keys[i].first; HBS_SPAN_NONE != j;
+             j = map->spans[j].next) {
+            *length += 1;
+        }
+    }
+
+    size_t* indices = malloc((*length + 1) * sizeof(size_t));
+    if (NULL == indices) {
+        return NULL;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < map->key_count; ++i) {
+        if (!map->keys[i].changed) {
+            continue;
+        }
+        for (size_t j = map->keys[i].first; HBS_SPAN_NONE != j;
+             j = map->spans[j].next) {
+            indices[count++] = j;
+        }
+    }
+
+    qsort(indices, count, sizeof(size_t), priv_compare_indices);
+    return indices;
+}
+
+// Return the offset in the output of the span at <index>, including the
+// shift that's pending for it.
+static size_t priv_span_offset(const HbsSpanMap* map, size_t index) {
+    const size_t offset = map->spans[index].offset;
+    return index >= map->shift_position ? offset + map->shift : offset;
+}
+
+// Move the start of the pending shift to <index>, applying it to (or taking
+// it back from) the spans in between. Successive patches tend to change the
+// same keys, so this rarely has far to go.
+static void priv_move_shift(HbsSpanMap* map, size_t index) {
+    if (0 == map->shift) {
+        map->shift_position = index;
+        return;
+    }
+
+    for (; map->shift_position < index; ++map->shift_position) {
+        map->spans[map->shift_position].offset += map->shift;
+    }
+    for (; map->shift_position > index; --map->shift_position) {
+        map->spans[map->shift_position - 1].offset -= map->shift;
+    }
+}
+
+static inline ptrdiff_t priv_span_growth(const HbsSpanMap* map, size_t index)
+{
+    const HbsSpan* span = &map->spans[index];
+    return (ptrdiff_t)map->keys[span->slot].value_length
+        - (ptrdiff_t)span->length;
+}
+
+// Move the bytes of <output> between the <i>th of the changed spans at
+// <indices> and the next one (or the end) by <shift>.
+static void priv_move_gap(const HbsSpanMap* map, const size_t* indices,
+    size_t count, size_t i, HbsString* output, ptrdiff_t shift)
+{
+    const HbsSpan* span = &map->spans[indices[i]];
+    const size_t begin = span->offset + span->length;
+    const size_t end = i + 1 < count
+        ? map->spans[indices[i + 1]].offset : output->length;
+    memmove(output->string + begin + shift, output->string + begin,
+        end - begin);
+}
+
+// Replace the <count> spans at <indices> in <output> with the new values of
+// their keys, in place, when their lengths have changed.
+static int priv_patch_resized(HbsSpanMap* map, const size_t* indices,
+    size_t count, HbsString* output, const HbsString* values)
+{
+    // The spans up to the last changed one are given their new offsets here,
+    // and those after it are shifted lazily.
+    priv_move_shift(map, indices[count - 1] + 1);
+
+    ptrdiff_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += priv_span_growth(map, indices[i]);
+    }
+    if (0 != hbs_string_reserve(output, output->length + total)) {
+        return 1;
+    }
+
+    // The bytes between each changed span and the next move by the growth of
+    // the spans before them. Those moving back are moved from the front, and
+    // then those moving forward from the back, so that none of them are
+    // overwritten before they're moved.
+    ptrdiff_t shift = 0;
+    for (size_t i = 0; i < count; ++i) {
+        shift += priv_span_growth(map, indices[i]);
+        if (shift < 0) {
+            priv_move_gap(map, indices, count, i, output, shift);
+        }
+    }
+    for (size_t i = count; 0 < i--;) {
+        if (shift > 0) {
+            priv_move_gap(map, indices, count, i, output, shift);
+        }
+        shift -= priv_span_growth(map, indices[i]);
+    }
+
+    for (size_t i = indices[0], j = 0; i < indices[count - 1] + 1; ++i) {
+        HbsSpan* span = &map->spans[i];
+        span->offset += shift;
+        if (indices[j] == i) {
+            const HbsSpanKey* key = &map->keys[span->slot];
+            memcpy(output->string + span->offset,
+                values->string + key->value_offset, key->value_length);
+            shift += priv_span_growth(map, i);
+            span->length = key->value_length;
+            j += 1;
+        }
+    }
+
+    output->length += total;
+    output->string[output->length] = '\0';
+    map->shift += total;
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+HbsSpanMap* hbs_span_map_new(const HbsTemplate* template) {
+    HbsSpanMap* map = calloc(1, sizeof(HbsSpanMap));
+    if (NULL == map) {
+        return NULL;
+    }
+
+    map->key_count = hbs_symbol_table_length(template->keys);
+    map->keys = calloc(map->key_count + 1, sizeof(HbsSpanKey));
+    if (NULL == map->keys) {
+        free(map);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < map->key_count; ++i) {
+        map->keys[i].first = HBS_SPAN_NONE;
+        map->keys[i].last = HBS_SPAN_NONE;
+        map->keys[i].component = HBS_SPAN_NONE;
+    }
+
+    priv_classify_keys(map, template);
+    return map;
+}
+
+int hbs_span_map_record(HbsSpanMap* map, size_t slot, size_t offset,
+    size_t length)
+{
+    if (map->length == map->capacity) {
+        const size_t capacity = 0 == map->capacity ? 16 : 2 * map->capacity;
+        HbsSpan* spans = realloc(map->spans, capacity * sizeof(HbsSpan));
+        if (NULL == spans) {
+            return 1;
+        }
+        map->spans = spans;
+        map->capacity = capacity;
+    }
+
+    const size_t index = map->length++;
+    map->spans[index] = (HbsSpan){offset, length, slot, HBS_SPAN_NONE};
+    HbsSpanKey* key = &map->keys[slot];
+    if (HBS_SPAN_NONE == key->last) {
+        key->first = index;
+    } else {
+        map->spans[key->last].next = index;
+    }
+    key->last = index;
+    return 0;
+}
+
+// The output is patched in place. If the lengths of the values haven't
+// changed, they're copied over the old ones. Otherwise, the bytes after the
+// first changed span are moved once, and only the spans up to the last
+// changed one are shifted right away.
+int hbs_span_map_patch(HbsSpanMap* map, HbsString* output,
+    const HbsString* values)
+{
+    size_t count = 0;
+    size_t* indices = priv_changed_spans(map, &count);
+    if (NULL == indices) {
+        hbs_span_map_reset(map);
+        return 1;
+    }
+
+    bool resized = false;
+    for (size_t i = 0; i < count; ++i) {
+        const HbsSpan* span = &map->spans[indices[i]];
+        resized = resized
+            || span->length != map->keys[span->slot].value_length;
+    }
+
+    int result = 0;
+    if (resized) {
+        result = priv_patch_resized(map, indices, count, output, values);
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            const HbsSpan* span = &map->spans[indices[i]];
+            memcpy(output->string + priv_span_offset(map, indices[i]),
+                values->string + map->keys[span->slot].value_offset,
+                span->length);
+        }
+    }
+
+    hbs_span_map_reset(map);
+    free(indices);
+    return result;
+}
+
+void hbs_span_map_reset(HbsSpanMap* map) {
+    for (size_t i = 0; i < map->key_count; ++i) {
+        map->keys[i].changed = false;
+    }
+}
+
+void hbs_span_map_replace(HbsSpanMap* map, HbsSpanMap* other) {
+    free(map->spans);
+    free(map->keys);
+    *map = *other;
+    free(other);
+}
+
+void hbs_span_map_free(HbsSpanMap* map) {
+    free(map->spans);
+    free(map->keys);
+    free(map);
+}
+
+///////////////////////////////////////////////////////////////////////////////
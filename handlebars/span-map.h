@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            span-map.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Records where the values of expressions were rendered.
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+////
+
+#ifndef HANDLEBARS_SPAN_MAP_H
+#define HANDLEBARS_SPAN_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct HbsString HbsString;
+typedef struct HbsTemplate HbsTemplate;
+
+// Returned when there is no span or component.
+#define HBS_SPAN_NONE SIZE_MAX
+
+// Bytes of the output holding the value of one expression.
+typedef struct HbsSpan {
+    size_t offset;
+    size_t length;
+    size_t slot;
+
+    // Index of the next span holding the value of the same key.
+    size_t next;
+} HbsSpan;
+
+// What the span map knows about each key of the template, indexed by slot.
+typedef struct HbsSpanKey {
+    // Spans holding the value of the key, in order of their offsets.
+    size_t first;
+    size_t last;
+
+    // Position in the template of an expression whose value is the value of
+    // the key, which is used to resolve it again.
+    size_t component;
+
+    // Set if the key's value can affect the output other than through its
+    // spans (e.g. it's the key of a block), in which case the output can't
+    // be patched when it changes.
+    bool structural;
+
+    // Used by hbs_span_map_patch().
+    bool changed;
+    size_t value_offset;
+    size_t value_length;
+} HbsSpanKey;
+
+typedef struct HbsSpanMap {
+    HbsSpan* spans;
+    size_t length;
+    size_t capacity;
+
+    HbsSpanKey* keys;
+    size_t key_count;
+
+    // Patches shift the offsets of the spans after them lazily: the offsets
+    // of the spans from <shift_position> onwards are short by <shift>, which
+    // wraps, so that it can move them back, too.
+    size_t shift_position;
+    size_t shift;
+} HbsSpanMap;
+
+// Create an empty span map for <template>, which must be loaded, classifying
+// its keys. Only the values of expressions relative to the top level of the
+// template are recorded; other keys are structural.
+HbsSpanMap* hbs_span_map_new(const HbsTemplate* template);
+
+// Record that bytes [<offset>, <offset> + <length>) of the output hold the
+// value of the key in <slot>. Spans must be recorded in order of their
+// offsets.
+int hbs_span_map_record(HbsSpanMap* map, size_t slot, size_t offset,
+    size_t length);
+
+// Replace the spans of every key marked as changed with its new value, which
+// is stored at keys[slot].value_offset in <values>, shifting the rest of
+// <output> and the spans after them. Clears the changed flags, even if it
+// fails (leaving <output> unchanged).
+int hbs_span_map_patch(HbsSpanMap* map, HbsString* output,
+    const HbsString* values);
+
+// Clear the changed flags of the keys.
+void hbs_span_map_reset(HbsSpanMap* map);
+
+// Replace the contents of <map> with those of <other>, which is free'd.
+void hbs_span_map_replace(HbsSpanMap* map, HbsSpanMap* other);
+
+#endif // HANDLEBARS_SPAN_MAP_H
+
+///////////////////////////////////////////////////////////////////////////////
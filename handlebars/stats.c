@@ -0,0 +1,289 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            stats.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Runtime statistics of templates.
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+////
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <handlebars/handlebars.h>
+#include <handlebars/nary-tree.h>
+#include <handlebars/parser.h>
+#include <handlebars/template.h>
+
+// A family of metrics in the Prometheus exposition, whose value for each
+// template is the member at <offset> in HbsTemplateStats.
+typedef struct HbsMetric {
+    const char* name;
+    const char* type;
+    const char* help;
+    size_t offset;
+    bool seconds;   // Convert the value from nanoseconds
+} HbsMetric;
+
+static const HbsMetric METRICS[] = {
+    {"hbs_template_renders_total", "counter",
+        "Completed renders of the template.",
+        offsetof(HbsTemplateStats, renders), false},
+    {"hbs_template_render_seconds_total", "counter",
+        "Time spent rendering the template.",
+        offsetof(HbsTemplateStats, render_time), true},
+    {"hbs_template_render_seconds_max", "gauge",
+        "Time of the longest render of the template.",
+        offsetof(HbsTemplateStats, max_render_time), true},
+    {"hbs_template_output_bytes_total", "counter",
+        "Output produced by renders of the template.",
+        offsetof(HbsTemplateStats, bytes), false},
+    {"hbs_template_handler_calls_total", "counter",
+        "Handlers called by renders of the template.",
+        offsetof(HbsTemplateStats, handler_calls), false},
+    {"hbs_template_handler_seconds_total", "counter",
+        "Time spent in handlers by renders of the template.",
+        offsetof(HbsTemplateStats, handler_time), true},
+    {"hbs_template_component_bytes", "gauge",
+        "Memory used by the components of the template.",
+        offsetof(HbsTemplateStats, component_size), false},
+    {"hbs_template_string_bytes", "gauge",
+        "Memory used by the strings of the template's components.",
+        offsetof(HbsTemplateStats, string_size), false},
+    {"hbs_template_node_bytes", "gauge",
+        "Memory used by the tree of the template's components.",
+        offsetof(HbsTemplateStats, node_size), false},
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+// Append <name> as the value of a label, escaping backslashes, quotes and
+// newlines.
+static int priv_append_label(HbsString* output, const char* name) {
+    const char* start = name;
+    for (const char* cursor = name; '\0' != *cursor; ++cursor) {
+        const char* escape = '\\' == *cursor ? "\\\\"
+            : '"' == *cursor ? "\\\""
+            : '\n' == *cursor ? "\\n" : NULL;
+        if (NULL == escape) {
+            continue;
+        }
+
+        if (0 != hbs_string_append_buffer(output, start, cursor - start)
+            || 0 != hbs_string_append_str(output, escape)) {
+            return 1;
+        }
+        start = cursor + 1;
+    }
+
+    return hbs_string_append_str(output, start);
+}
+
+// Append the sample of <metric> for the template <name>.
+static int priv_append_sample(HbsString* output, const HbsMetric* metric,
+    const char* name, const HbsTemplateStats* stats)
+{
+    const uint64_t count = *(const uint64_t*)(
+        (const char*)stats + metric->offset);
+    HbsValue value = {.type = HBS_VALUE_UINT, .uint_value = count};
+    if (metric->seconds) {
+        value.type = HBS_VALUE_DOUBLE;
+        value.double_value = (double)count / 1e9;
+    }
+
+    if (0 != hbs_string_append_str(output, metric->name)
+        || 0 != hbs_string_append_str(output, "{template=\"")
+        || 0 != priv_append_label(output, name)
+        || 0 != hbs_string_append_str(output, "\"} ")
+        || 0 != hbs_string_append_value(output, &value)) {
+        return 1;
+    }
+    return hbs_string_append_str(output, "\n");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+#ifndef HBS_DISABLE_STATS
+
+void hbs_template_count_render(HbsTemplate* template,
+    const HbsRenderCounts* counts)
+{
+    HbsTemplateCounters* counters = &template->counters;
+    atomic_fetch_add_explicit(&counters->renders, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters->render_time, counts->time,
+        memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters->bytes, counts->bytes,
+        memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters->handler_calls, counts->handler_calls,
+        memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters->handler_time, counts->handler_time,
+        memory_order_relaxed);
+
+    uint_least64_t longest = atomic_load_explicit(&counters->max_render_time,
+        memory_order_relaxed);
+    while (counts->time > longest && !atomic_compare_exchange_weak_explicit(
+            &counters->max_render_time, &longest, counts->time,
+            memory_order_relaxed, memory_order_relaxed)) {
+        // A failed exchange reloads <longest>.
+    }
+}
+
+void hbs_template_measure(HbsTemplate* template) {
+    size_t component_size = 0;
+    size_t string_size = 0;
+    size_t node_size = 0;
+    if (NULL != template->components) {
+        HbsNaryTreeIter iterator;
+        hbs_nary_tree_iter_init(&iterator, template->components);
+        HbsNaryNode* root = hbs_nary_tree_get_root(template->components);
+        HbsNaryNode* element = NULL;
+        while (root != (element = hbs_nary_tree_iter_next(&iterator))) {
+            hbs_component_measure(hbs_nary_node_get_data(element),
+                &component_size, &string_size);
+        }
+        node_size = hbs_nary_tree_size(template->components);
+    }
+
+    HbsTemplateCounters* counters = &template->counters;
+    atomic_store_explicit(&counters->component_size, component_size,
+        memory_order_relaxed);
+    atomic_store_explicit(&counters->string_size, string_size,
+        memory_order_relaxed);
+    atomic_store_explicit(&counters->node_size, node_size,
+        memory_order_relaxed);
+}
+
+void hbs_template_measure_splice(HbsTemplate* template, size_t position,
+    size_t count, HbsNaryTree* removed)
+{
+    size_t added_component_size = 0;
+    size_t added_string_size = 0;
+    for (size_t i = position; i < position + count; ++i) {
+        hbs_component_measure(hbs_nary_node_get_data(
+                hbs_nary_tree_node_at(template->components, i)),
+            &added_component_size, &added_string_size);
+    }
+
+    size_t removed_component_size = 0;
+    size_t removed_string_size = 0;
+    const size_t removed_count = hbs_nary_tree_length(removed) - 1;
+    for (size_t i = 0; i < removed_count; ++i) {
+        hbs_component_measure(hbs_nary_node_get_data(
+                hbs_nary_tree_node_at(removed, i)),
+            &removed_component_size, &removed_string_size);
+    }
+
+    HbsTemplateCounters* counters = &template->counters;
+    atomic_fetch_add_explicit(&counters->component_size,
+        added_component_size - removed_component_size, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters->string_size,
+        added_string_size - removed_string_size, memory_order_relaxed);
+    atomic_store_explicit(&counters->node_size,
+        hbs_nary_tree_size(template->components), memory_order_relaxed);
+}
+
+int hbs_template_stats(HbsTemplate* template, HbsTemplateStats* stats) {
+    HbsTemplateCounters* counters = &template->counters;
+    stats->renders = atomic_load_explicit(&counters->renders,
+        memory_order_relaxed);
+    stats->render_time = atomic_load_explicit(&counters->render_time,
+        memory_order_relaxed);
+    stats->max_render_time = atomic_load_explicit(&counters->max_render_time,
+        memory_order_relaxed);
+    stats->bytes = atomic_load_explicit(&counters->bytes,
+        memory_order_relaxed);
+    stats->handler_calls = atomic_load_explicit(&counters->handler_calls,
+        memory_order_relaxed);
+    stats->handler_time = atomic_load_explicit(&counters->handler_time,
+        memory_order_relaxed);
+    stats->component_size = atomic_load_explicit(&counters->component_size,
+        memory_order_relaxed);
+    stats->string_size = atomic_load_explicit(&counters->string_size,
+        memory_order_relaxed);
+    stats->node_size = atomic_load_explicit(&counters->node_size,
+        memory_order_relaxed);
+    return 0;
+}
+
+#else
+
+void hbs_template_count_render(
+    HbsTemplate* template __attribute__((unused)),
+    const HbsRenderCounts* counts __attribute__((unused)))
+{}
+
+void hbs_template_measure(HbsTemplate* template __attribute__((unused))) {}
+
+void hbs_template_measure_splice(
+    HbsTemplate* template __attribute__((unused)),
+    size_t position __attribute__((unused)),
+    size_t count __attribute__((unused)),
+    HbsNaryTree* removed __attribute__((unused)))
+{}
+
+int hbs_template_stats(HbsTemplate* template __attribute__((unused)),
+    HbsTemplateStats* stats)
+{
+    memset(stats, 0, sizeof(HbsTemplateStats));
+    return 1;
+}
+
+#endif // HBS_DISABLE_STATS
+
+// Each metric is a family of samples, one per template, which must be
+// written together, after the family's HELP and TYPE lines.
+int hbs_template_stats_prometheus(HbsString* output,
+    const char* const* names, const HbsTemplateStats* stats, size_t length)
+{
+    for (size_t i = 0; i < sizeof(METRICS) / sizeof(METRICS[0]); ++i) {
+        const HbsMetric* metric = &METRICS[i];
+        if (0 != hbs_string_append_str(output, "# HELP ")
+            || 0 != hbs_string_append_str(output, metric->name)
+            || 0 != hbs_string_append_str(output, " ")
+            || 0 != hbs_string_append_str(output, metric->help)
+            || 0 != hbs_string_append_str(output, "\n# TYPE ")
+            || 0 != hbs_string_append_str(output, metric->name)
+            || 0 != hbs_string_append_str(output, " ")
+            || 0 != hbs_string_append_str(output, metric->type)
+            || 0 != hbs_string_append_str(output, "\n")) {
+            return 1;
+        }
+
+        for (size_t j = 0; j < length; ++j) {
+            if (0 != priv_append_sample(output, metric, names[j], &stats[j])) {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
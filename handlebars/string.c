@@ -7,7 +7,7 @@
 //
 // CREATED:         11/22/2021
 //
-// LAST EDITED:     01/06/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -95,25 +95,55 @@ HbsString* hbs_string_from_str(const char* content) {
 }
 
 int hbs_string_append(HbsString* first, const HbsString* second) {
-    return hbs_string_append_str(first, second->string);
+    return hbs_string_append_buffer(first, second->string, second->length);
 }
 
-int hbs_string_append_str(HbsString* first, const char* second)
+int hbs_string_append_str(HbsString* first, const char* second) {
+    return hbs_string_append_buffer(first, second, strlen(second));
+}
+
+int hbs_string_append_buffer(HbsString* first, const char* buffer,
+    size_t length)
 {
-    const size_t append_length = strlen(second);
-    const size_t needed_capacity = append_length + first->length + 1;
+    const size_t needed_capacity = length + first->length + 1;
     if (needed_capacity > first->capacity) {
         if (0 != hbs_priv_string_extend(first, needed_capacity)) {
             return 1;
         }
     }
 
-    strncpy(first->string + first->length, second, append_length + 1);
-    first->length = append_length + first->length;
+    memcpy(first->string + first->length, buffer, length);
+    first->length = length + first->length;
     first->string[first->length] = '\0';
     return 0;
 }
 
+int hbs_string_reserve(HbsString* string, size_t length) {
+    if (length + 1 > string->capacity) {
+        return hbs_priv_string_extend(string, length + 1);
+    }
+    return 0;
+}
+
+int hbs_string_replace(HbsString* string, size_t offset, size_t removed,
+    const char* buffer, size_t length)
+{
+    const size_t needed_capacity = string->length - removed + length + 1;
+    if (needed_capacity > string->capacity) {
+        if (0 != hbs_priv_string_extend(string, needed_capacity)) {
+            return 1;
+        }
+    }
+
+    // The rest of the string is moved along with its terminator.
+    const size_t rest = offset + removed;
+    memmove(string->string + offset + length, string->string + rest,
+        string->length - rest + 1);
+    memcpy(string->string + offset, buffer, length);
+    string->length = string->length - removed + length;
+    return 0;
+}
+
 void hbs_string_free(HbsString* string) {
     free(string->string);
     free(string);
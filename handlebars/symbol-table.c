@@ -0,0 +1,171 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            symbol-table.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of the symbol table
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+////
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <handlebars/symbol-table.h>
+#include <handlebars/vector.h>
+
+static const size_t DEFAULT_BUCKET_COUNT = 16;
+
+typedef struct HbsSymbolTable {
+    // Interned copies of the symbols, indexed by id.
+    HbsVector* symbols;
+
+    // Open-addressed hash table (linear probing). Each bucket holds the id of
+    // a symbol plus one, so that zero can mark an empty bucket. The number of
+    // buckets is always a power of two.
+    size_t* buckets;
+    size_t bucket_count;
+} HbsSymbolTable;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+// Return a pointer to the bucket for <symbol>, which is either the bucket
+// holding it or the empty bucket where it would be inserted.
+static size_t* priv_find_bucket(const HbsSymbolTable* table,
+    const char* symbol, size_t length)
+{
+    const size_t mask = table->bucket_count - 1;
+    size_t index = hbs_hash_bytes(symbol, length) & mask;
+    while (0 != table->buckets[index]) {
+        const char* entry = table->symbols->vector[table->buckets[index] - 1];
+        if (0 == strcmp(entry, symbol)) {
+            break;
+        }
+        index = (index + 1) & mask;
+    }
+
+    return &table->buckets[index];
+}
+
+static int priv_rehash(HbsSymbolTable* table, size_t bucket_count) {
+    size_t* buckets = calloc(bucket_count, sizeof(size_t));
+    if (NULL == buckets) {
+        return 1;
+    }
+
+    free(table->buckets);
+    table->buckets = buckets;
+    table->bucket_count = bucket_count;
+    for (size_t i = 0; i < table->symbols->length; ++i) {
+        const char* symbol = table->symbols->vector[i];
+        *priv_find_bucket(table, symbol, strlen(symbol)) = i + 1;
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+HbsSymbolTable* hbs_symbol_table_new() {
+    HbsSymbolTable* table = malloc(sizeof(HbsSymbolTable));
+    if (NULL == table) {
+        return NULL;
+    }
+
+    memset(table, 0, sizeof(HbsSymbolTable));
+    table->symbols = hbs_vector_new();
+    table->buckets = calloc(DEFAULT_BUCKET_COUNT, sizeof(size_t));
+    if (NULL == table->symbols || NULL == table->buckets) {
+        hbs_symbol_table_free(table);
+        return NULL;
+    }
+
+    table->bucket_count = DEFAULT_BUCKET_COUNT;
+    return table;
+}
+
+void hbs_symbol_table_free(HbsSymbolTable* table) {
+    if (NULL != table->symbols) {
+        hbs_vector_free(table->symbols, free);
+    }
+    free(table->buckets);
+    free(table);
+}
+
+size_t hbs_symbol_table_intern(HbsSymbolTable* table, const char* symbol) {
+    const size_t length = strlen(symbol);
+    size_t* bucket = priv_find_bucket(table, symbol, length);
+    if (0 != *bucket) {
+        return *bucket - 1;
+    }
+
+    // Keep the load factor at or below one half.
+    if (2 * (table->symbols->length + 1) > table->bucket_count) {
+        if (0 != priv_rehash(table, 2 * table->bucket_count)) {
+            return HBS_SYMBOL_NONE;
+        }
+        bucket = priv_find_bucket(table, symbol, length);
+    }
+
+    char* copy = malloc(length + 1);
+    if (NULL == copy) {
+        return HBS_SYMBOL_NONE;
+    }
+
+    memcpy(copy, symbol, length + 1);
+    if (0 != hbs_vector_push_back(table->symbols, copy)) {
+        free(copy);
+        return HBS_SYMBOL_NONE;
+    }
+
+    *bucket = table->symbols->length;
+    return table->symbols->length - 1;
+}
+
+size_t hbs_symbol_table_find(const HbsSymbolTable* table, const char* symbol)
+{
+    size_t* bucket = priv_find_bucket(table, symbol, strlen(symbol));
+    return 0 != *bucket ? *bucket - 1 : HBS_SYMBOL_NONE;
+}
+
+size_t hbs_symbol_table_length(const HbsSymbolTable* table)
+{ return table->symbols->length; }
+
+const char* const* hbs_symbol_table_symbols(const HbsSymbolTable* table)
+{ return (const char* const*)table->symbols->vector; }
+
+uint64_t hbs_hash_bytes(const void* data, size_t length) {
+    const unsigned char* bytes = data;
+    uint64_t hash = 14695981039346656037u;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211u;
+    }
+    return hash;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            symbol-table.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Symbol table, for interning strings into dense integer ids.
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+////
+
+#ifndef HANDLEBARS_SYMBOL_TABLE_H
+#define HANDLEBARS_SYMBOL_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Returned by the lookup functions when a symbol could not be found (or could
+// not be interned).
+#define HBS_SYMBOL_NONE SIZE_MAX
+
+typedef struct HbsSymbolTable HbsSymbolTable;
+
+HbsSymbolTable* hbs_symbol_table_new();
+void hbs_symbol_table_free(HbsSymbolTable* table);
+
+// Return the id of <symbol>, interning a copy of it if it hasn't been seen
+// before. Ids are assigned densely, starting from zero, in order of first
+// appearance.
+size_t hbs_symbol_table_intern(HbsSymbolTable* table, const char* symbol);
+
+// Return the id of <symbol>, or HBS_SYMBOL_NONE if it hasn't been interned.
+size_t hbs_symbol_table_find(const HbsSymbolTable* table, const char* symbol);
+
+// Return the number of symbols in the table.
+size_t hbs_symbol_table_length(const HbsSymbolTable* table);
+
+// Return the array of symbols in the table, indexed by id.
+const char* const* hbs_symbol_table_symbols(const HbsSymbolTable* table);
+
+// FNV-1a hash of <length> bytes at <data>.
+uint64_t hbs_hash_bytes(const void* data, size_t length);
+
+#endif // HANDLEBARS_SYMBOL_TABLE_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,677 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            template-set.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Sets of templates, which are linked to inline partials.
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+////
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <handlebars/handlebars.h>
+#include <handlebars/nary-tree.h>
+#include <handlebars/parser.h>
+#include <handlebars/scanner.h>
+#include <handlebars/symbol-table.h>
+#include <handlebars/template.h>
+#include <handlebars/vector.h>
+
+// A named template of the set, which may not have been added yet if it's
+// only been referred to as a partial.
+typedef struct HbsSetEntry {
+    // Components as parsed, before partials are inlined or keys bound.
+    HbsNaryTree* source;
+
+    // The components of <source> in order, which aren't owned by the vector.
+    // Blocks are inlined as runs of these.
+    HbsVector* components;
+
+    // The most recent version of the template that linked successfully.
+    HbsTemplate* template;
+
+    // Ids of the partials named statically by <source>. These are the edges
+    // of the dependency graph, which is walked backwards to find the
+    // templates that need to be relinked when a partial changes.
+    HbsVector* partials;
+
+    // Set when the source changes, and cleared once the set is linked.
+    bool dirty;
+
+    // Set while the entry is being inlined, to detect recursive partials.
+    bool visiting;
+} HbsSetEntry;
+
+typedef struct HbsTemplateSet {
+    const HbsHelperRegistry* helpers;
+
+    // Entries, indexed by the id of their name.
+    HbsSymbolTable* names;
+    HbsVector* entries;
+} HbsTemplateSet;
+
+// Limit on the number of inline partials defined by one template or partial
+// block.
+#define HBS_MAX_INLINE_PARTIALS 32
+
+struct HbsScope;
+
+// A run of the components of a source, and the scope that the partials it
+// names are resolved in.
+typedef struct HbsRange {
+    const HbsVector* components;
+    size_t begin;
+    size_t end;
+    const struct HbsScope* scope;
+} HbsRange;
+
+// Inline partials ("{{#*inline "name"}}...{{/inline}}") defined by a template
+// or by the body of a partial block, which override partials of the same
+// name while the template or block is inlined. The innermost definition of a
+// name wins.
+typedef struct HbsScope {
+    const struct HbsScope* parent;
+    const HbsString* names[HBS_MAX_INLINE_PARTIALS];
+    HbsRange inlines[HBS_MAX_INLINE_PARTIALS];
+    size_t inline_count;
+
+    // Body of the partial block that the scope belongs to, which is inlined
+    // by "{{> @partial-block}}". <components> is NULL if there isn't one.
+    HbsRange block;
+} HbsScope;
+
+// The linked component tree under construction. <text> is the last component
+// appended, if it's text, so that the text around partials can be merged.
+typedef struct HbsSplice {
+    HbsNaryTree* tree;
+    HbsNaryNode* root;
+    HbsComponent* text;
+} HbsSplice;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static void priv_entry_free(void* data) {
+    HbsSetEntry* entry = data;
+    if (NULL != entry->source) {
+        hbs_nary_tree_free(entry->source);
+    }
+    if (NULL != entry->template) {
+        hbs_template_free(entry->template);
+    }
+    if (NULL != entry->components) {
+        hbs_vector_free(entry->components, NULL);
+    }
+    if (NULL != entry->partials) {
+        hbs_vector_free(entry->partials, NULL);
+    }
+    free(entry);
+}
+
+static const char* priv_argument(const HbsComponent* component, size_t index)
+{ return ((HbsString*)component->argv->vector[index])->string; }
+
+// Return the id of the entry named <name>, creating it if necessary, or
+// HBS_SYMBOL_NONE if memory can't be allocated.
+static size_t priv_entry_id(HbsTemplateSet* set, const char* name) {
+    const size_t id = hbs_symbol_table_intern(set->names, name);
+    if (HBS_SYMBOL_NONE == id || id < set->entries->length) {
+        return id;
+    }
+
+    // The symbol table has grown, so the entries must grow with it.
+    HbsSetEntry* entry = calloc(1, sizeof(HbsSetEntry));
+    if (NULL == entry || 0 != hbs_vector_push_back(set->entries, entry)) {
+        free(entry);
+        return HBS_SYMBOL_NONE;
+    }
+    return id;
+}
+
+// Return the name of the partial or partial block <component>, if it's
+// static and refers to a template of the set, or NULL.
+static const char* priv_static_partial(const HbsComponent* component) {
+    if (HBS_COMPONENT_PARTIAL != component->type
+        && HBS_COMPONENT_PARTIAL_BLOCK != component->type) {
+        return NULL;
+    }
+
+    const char* name = priv_argument(component, 0);
+    return 0 != strcmp("(", name) && 0 != strcmp("@partial-block", name)
+        ? name : NULL;
+}
+
+// Return true if <component> opens the definition of an inline partial.
+static bool priv_is_inline(const HbsComponent* component) {
+    return HBS_COMPONENT_BLOCK_OPEN == component->type
+        && 0 == strcmp("*inline", priv_argument(component, 0));
+}
+
+// Return the index of the component which closes the block opened at
+// <begin>, or <end> if it isn't closed before then.
+static size_t priv_find_close(const HbsVector* components, size_t begin,
+    size_t end)
+{
+    // "{{#*inline}}" is closed by "{{/inline}}".
+    const HbsComponent* open = components->vector[begin];
+    const char* name = priv_argument(open, 0) + (priv_is_inline(open) ? 1 : 0);
+    size_t depth = 0;
+    for (size_t i = begin + 1; i < end; ++i) {
+        const HbsComponent* component = components->vector[i];
+        if (HBS_COMPONENT_BLOCK_OPEN == component->type
+            || HBS_COMPONENT_PARTIAL_BLOCK == component->type) {
+            depth += 1;
+        } else if (HBS_COMPONENT_BLOCK_CLOSE == component->type) {
+            if (0 == depth) {
+                return 0 == strcmp(name, priv_argument(component, 0))
+                    ? i : end;
+            }
+            depth -= 1;
+        }
+    }
+
+    return end;
+}
+
+// Return true if the quoted string <quoted> is <name>.
+static bool priv_inline_is_named(const HbsString* quoted, const char* name) {
+    const size_t length = strlen(name);
+    return length + 2 == quoted->length
+        && 0 == strncmp(quoted->string + 1, name, length);
+}
+
+// Record the inline partials defined at the top level of <range> in <scope>.
+// They're inlined in the scope that <scope> was entered from.
+static int priv_collect_inlines(HbsScope* scope, const HbsRange* range) {
+    for (size_t i = range->begin; i < range->end; ++i) {
+        const HbsComponent* component = range->components->vector[i];
+        if (!priv_is_inline(component)) {
+            continue;
+        }
+
+        const size_t close = priv_find_close(range->components, i,
+            range->end);
+        const HbsString* name = 2 == component->argv->length
+            ? component->argv->vector[1] : NULL;
+        if (range->end == close || NULL == name || 2 > name->length
+            || ('"' != name->string[0] && '\'' != name->string[0])
+            || HBS_MAX_INLINE_PARTIALS == scope->inline_count) {
+            return 1;
+        }
+
+        scope->names[scope->inline_count] = name;
+        scope->inlines[scope->inline_count] = (HbsRange){
+            range->components, i + 1, close, scope->parent};
+        scope->inline_count += 1;
+        i = close;
+    }
+
+    return 0;
+}
+
+// Find the innermost inline partial named <name>.
+static const HbsRange* priv_find_inline(const HbsScope* scope,
+    const char* name)
+{
+    for (; NULL != scope; scope = scope->parent) {
+        for (size_t i = scope->inline_count; i > 0; --i) {
+            if (priv_inline_is_named(scope->names[i - 1], name)) {
+                return &scope->inlines[i - 1];
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// Find the body of the innermost partial block.
+static const HbsRange* priv_find_block(const HbsScope* scope) {
+    for (; NULL != scope; scope = scope->parent) {
+        if (NULL != scope->block.components) {
+            return &scope->block;
+        }
+    }
+
+    return NULL;
+}
+
+// Collect the ids of the partials named statically by <source>.
+static HbsVector* priv_find_partials(HbsTemplateSet* set, HbsNaryTree* source)
+{
+    HbsVector* partials = hbs_vector_new();
+    if (NULL == partials) {
+        return NULL;
+    }
+
+    HbsNaryTreeIter iterator;
+    hbs_nary_tree_iter_init(&iterator, source);
+    HbsNaryNode* root = hbs_nary_tree_get_root(source);
+    HbsNaryNode* element = NULL;
+    while (root != (element = hbs_nary_tree_iter_next(&iterator))) {
+        const char* name = priv_static_partial(
+            hbs_nary_node_get_data(element));
+        if (NULL == name) {
+            continue;
+        }
+
+        const size_t id = priv_entry_id(set, name);
+        if (HBS_SYMBOL_NONE == id
+            || 0 != hbs_vector_push_back(partials, (void*)id)) {
+            hbs_vector_free(partials, NULL);
+            return NULL;
+        }
+    }
+
+    return partials;
+}
+
+// List the components of <source> in order.
+static HbsVector* priv_flatten(HbsNaryTree* source) {
+    HbsVector* components = hbs_vector_new();
+    if (NULL == components) {
+        return NULL;
+    }
+
+    HbsNaryTreeIter iterator;
+    hbs_nary_tree_iter_init(&iterator, source);
+    HbsNaryNode* root = hbs_nary_tree_get_root(source);
+    HbsNaryNode* element = NULL;
+    while (root != (element = hbs_nary_tree_iter_next(&iterator))) {
+        if (0 != hbs_vector_push_back(components,
+                hbs_nary_node_get_data(element))) {
+            hbs_vector_free(components, NULL);
+            return NULL;
+        }
+    }
+
+    return components;
+}
+
+// Mark every template which includes a dirty template as a partial dirty,
+// too, until there are no more to mark.
+static void priv_propagate_dirty(HbsTemplateSet* set) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < set->entries->length; ++i) {
+            HbsSetEntry* entry = set->entries->vector[i];
+            if (entry->dirty || NULL == entry->partials) {
+                continue;
+            }
+
+            for (size_t j = 0; j < entry->partials->length; ++j) {
+                const size_t id = (size_t)entry->partials->vector[j];
+                if (((HbsSetEntry*)set->entries->vector[id])->dirty) {
+                    entry->dirty = true;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Append <component> to the linked tree, taking ownership of it.
+static int priv_splice_component(HbsSplice* splice, HbsComponent* component)
+{
+    if (HBS_COMPONENT_TEXT == component->type && NULL != splice->text) {
+        int result = hbs_string_append(splice->text->text, component->text);
+        hbs_component_free(component);
+        return result;
+    }
+
+    HbsNaryNode* node = hbs_nary_node_new(component,
+        (void (*)(void*))hbs_component_free);
+    if (NULL == node) {
+        hbs_component_free(component);
+        return 1;
+    }
+
+    hbs_nary_tree_append_child_to_node(splice->tree, splice->root, node);
+    splice->text = HBS_COMPONENT_TEXT == component->type ? component : NULL;
+    return 0;
+}
+
+// Append the open ("{{#with key}}") or close ("{{/with}}") component of a
+// block which provides the context of a partial.
+static int priv_splice_context(HbsSplice* splice, const HbsString* key) {
+    HbsComponent* component = calloc(1, sizeof(HbsComponent));
+    if (NULL == component) {
+        return 1;
+    }
+
+    component->type = NULL != key ? HBS_COMPONENT_BLOCK_OPEN
+        : HBS_COMPONENT_BLOCK_CLOSE;
+    component->argv = hbs_vector_new();
+    HbsString* name = hbs_string_from_str("with");
+    HbsString* copy = NULL != key ? hbs_string_from_str(key->string) : NULL;
+    if (NULL == component->argv || NULL == name
+        || 0 != hbs_vector_push_back(component->argv, name)) {
+        if (NULL != name) {
+            hbs_string_free(name);
+        }
+        if (NULL != copy) {
+            hbs_string_free(copy);
+        }
+        hbs_component_free(component);
+        return 1;
+    }
+
+    if (NULL != key && (NULL == copy
+            || 0 != hbs_vector_push_back(component->argv, copy))) {
+        if (NULL != copy) {
+            hbs_string_free(copy);
+        }
+        hbs_component_free(component);
+        return 1;
+    }
+
+    return priv_splice_component(splice, component);
+}
+
+static int priv_splice_range(HbsTemplateSet* set, const HbsRange* range,
+    HbsSplice* splice);
+
+// Append copies of the components of <entry> to the linked tree, inlining
+// its partials.
+static int priv_splice_template(HbsTemplateSet* set, HbsSetEntry* entry,
+    const HbsScope* scope, HbsSplice* splice)
+{
+    // Recursive partials never finish.
+    if (entry->visiting) {
+        return 1;
+    }
+
+    HbsScope local = {.parent = scope};
+    const HbsRange range = {
+        entry->components, 0, entry->components->length, &local};
+    if (0 != priv_collect_inlines(&local, &range)) {
+        return 1;
+    }
+
+    entry->visiting = true;
+    int result = priv_splice_range(set, &range, splice);
+    entry->visiting = false;
+    return result;
+}
+
+// Inline the partial named <name>. If the partial is a partial block, <body>
+// is its body, which defines its inline partials and "{{> @partial-block}}".
+static int priv_splice_named(HbsTemplateSet* set, const char* name,
+    const HbsRange* body, const HbsScope* scope, HbsSplice* splice)
+{
+    if (0 == strcmp("@partial-block", name)) {
+        const HbsRange* block = priv_find_block(scope);
+        return NULL != block ? priv_splice_range(set, block, splice) : 1;
+    }
+
+    const HbsRange* override = priv_find_inline(scope, name);
+    if (NULL != override) {
+        return priv_splice_range(set, override, splice);
+    }
+
+    HbsScope inner = {.parent = scope};
+    if (NULL != body && 0 != priv_collect_inlines(&inner, body)) {
+        return 1;
+    }
+
+    const size_t id = hbs_symbol_table_find(set->names, name);
+    HbsSetEntry* partial = HBS_SYMBOL_NONE != id
+        ? set->entries->vector[id] : NULL;
+    if (NULL != partial && NULL != partial->source) {
+        if (NULL != body) {
+            inner.block = *body;
+        }
+        return priv_splice_template(set, partial, &inner, splice);
+    }
+
+    // Missing partials can't be inlined, unless they're partial blocks, whose
+    // bodies are the default content.
+    if (NULL == body) {
+        return 1;
+    }
+
+    HbsRange content = *body;
+    content.scope = &inner;
+    return priv_splice_range(set, &content, splice);
+}
+
+// Inline the partial or partial block <component>, wrapping it in a
+// "{{#with}}" block if it's given a context.
+static int priv_splice_partial(HbsTemplateSet* set,
+    const HbsComponent* component, const HbsRange* body,
+    const HbsScope* scope, HbsSplice* splice)
+{
+    const char* name = priv_argument(component, 0);
+    if (0 == strcmp("(", name) || 2 < component->argv->length) {
+        return 1;
+    }
+
+    const HbsString* key = 2 == component->argv->length
+        ? component->argv->vector[1] : NULL;
+    if (NULL != key && 0 != priv_splice_context(splice, key)) {
+        return 1;
+    }
+
+    if (0 != priv_splice_named(set, name, body, scope, splice)) {
+        return 1;
+    }
+
+    return NULL != key ? priv_splice_context(splice, NULL) : 0;
+}
+
+// Append copies of the components in <range> to the linked tree, inlining
+// partials and partial blocks. Inline partials were recorded when their scope
+// was entered, so their definitions are skipped.
+static int priv_splice_range(HbsTemplateSet* set, const HbsRange* range,
+    HbsSplice* splice)
+{
+    for (size_t i = range->begin; i < range->end; ++i) {
+        const HbsComponent* component = range->components->vector[i];
+        if (priv_is_inline(component)
+            || HBS_COMPONENT_PARTIAL_BLOCK == component->type) {
+            const size_t close = priv_find_close(range->components, i,
+                range->end);
+            if (range->end == close) {
+                return 1;
+            }
+
+            const HbsRange body = {range->components, i + 1, close,
+                range->scope};
+            if (HBS_COMPONENT_PARTIAL_BLOCK == component->type
+                && 0 != priv_splice_partial(set, component, &body,
+                    range->scope, splice)) {
+                return 1;
+            }
+            i = close;
+            continue;
+        }
+
+        if (HBS_COMPONENT_PARTIAL == component->type
+            && 0 != strcmp("(", priv_argument(component, 0))) {
+            if (0 != priv_splice_partial(set, component, NULL, range->scope,
+                    splice)) {
+                return 1;
+            }
+            continue;
+        }
+
+        HbsComponent* copy = hbs_component_copy(component);
+        if (NULL == copy || 0 != priv_splice_component(splice, copy)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// Build the linked template for <entry>.
+static HbsTemplate* priv_link(HbsTemplateSet* set, HbsSetEntry* entry) {
+    HbsSplice splice = {0};
+    splice.tree = hbs_nary_tree_new();
+    if (NULL == splice.tree) {
+        return NULL;
+    }
+
+    splice.root = hbs_nary_node_new(NULL, NULL);
+    if (NULL == splice.root) {
+        hbs_nary_tree_free(splice.tree);
+        return NULL;
+    }
+
+    hbs_nary_tree_set_root(splice.tree, splice.root);
+    if (0 != priv_splice_template(set, entry, NULL, &splice)) {
+        hbs_nary_tree_free(splice.tree);
+        return NULL;
+    }
+
+    return hbs_template_from_components(splice.tree, set->helpers, set);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+HbsTemplateSet* hbs_template_set_new(const HbsHelperRegistry* registry) {
+    HbsTemplateSet* set = malloc(sizeof(HbsTemplateSet));
+    if (NULL == set) {
+        return NULL;
+    }
+
+    set->helpers = registry;
+    set->names = hbs_symbol_table_new();
+    set->entries = hbs_vector_new();
+    if (NULL == set->names || NULL == set->entries) {
+        hbs_template_set_free(set);
+        return NULL;
+    }
+
+    return set;
+}
+
+// Parse the template, and record which partials it names, so that it can be
+// relinked when they change.
+int hbs_template_set_add(HbsTemplateSet* set, const char* name,
+    HbsInputContext* input_context)
+{
+    HbsScanner* scanner = hbs_scanner_new(input_context);
+    if (NULL == scanner) {
+        return 1;
+    }
+    HbsParser* parser = hbs_parser_new(scanner);
+    if (NULL == parser) {
+        hbs_scanner_free(scanner);
+        return 1;
+    }
+
+    HbsNaryTree* source = NULL;
+    int result = hbs_parser_parse(parser, &source);
+    hbs_template_record_error(parser);
+    hbs_parser_free(parser);
+    hbs_scanner_free(scanner);
+    if (0 != result) {
+        return 1;
+    }
+
+    const size_t id = priv_entry_id(set, name);
+    HbsVector* partials = HBS_SYMBOL_NONE != id
+        ? priv_find_partials(set, source) : NULL;
+    HbsVector* components = NULL != partials
+        ? priv_flatten(source) : NULL;
+    if (NULL == components) {
+        if (NULL != partials) {
+            hbs_vector_free(partials, NULL);
+        }
+        hbs_nary_tree_free(source);
+        return 1;
+    }
+
+    HbsSetEntry* entry = set->entries->vector[id];
+    if (NULL != entry->source) {
+        hbs_nary_tree_free(entry->source);
+        hbs_vector_free(entry->components, NULL);
+        hbs_vector_free(entry->partials, NULL);
+    }
+
+    entry->source = source;
+    entry->components = components;
+    entry->partials = partials;
+    entry->dirty = true;
+    return 0;
+}
+
+// Relink every template affected by the changes since the last link. Each
+// template is linked from the sources of itself and its partials, so the
+// order doesn't matter.
+size_t hbs_template_set_link(HbsTemplateSet* set) {
+    priv_propagate_dirty(set);
+    size_t failures = 0;
+    for (size_t i = 0; i < set->entries->length; ++i) {
+        HbsSetEntry* entry = set->entries->vector[i];
+        if (!entry->dirty || NULL == entry->source) {
+            continue;
+        }
+
+        HbsTemplate* template = priv_link(set, entry);
+        if (NULL == template) {
+            failures += 1;
+            continue;
+        }
+
+        if (NULL != entry->template) {
+            hbs_template_free(entry->template);
+        }
+        entry->template = template;
+    }
+
+    for (size_t i = 0; i < set->entries->length; ++i) {
+        ((HbsSetEntry*)set->entries->vector[i])->dirty = false;
+    }
+    return failures;
+}
+
+HbsTemplate* hbs_template_set_get(HbsTemplateSet* set, const char* name) {
+    const size_t id = hbs_symbol_table_find(set->names, name);
+    if (HBS_SYMBOL_NONE == id) {
+        return NULL;
+    }
+
+    return ((HbsSetEntry*)set->entries->vector[id])->template;
+}
+
+void hbs_template_set_free(HbsTemplateSet* set) {
+    if (NULL != set->entries) {
+        hbs_vector_free(set->entries, priv_entry_free);
+    }
+    if (NULL != set->names) {
+        hbs_symbol_table_free(set->names);
+    }
+    free(set);
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,195 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            template.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Internal representation of a loaded template, shared by the
+//                  loader and the renderer.
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+////
+
+#ifndef HANDLEBARS_TEMPLATE_H
+#define HANDLEBARS_TEMPLATE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+// Maximum nesting depth of blocks within a template.
+#define HBS_MAX_BLOCK_DEPTH 32
+
+// Maximum number of values on the operand stack while evaluating a helper
+// call, which holds the arguments of the innermost call and those already
+// resolved for the calls enclosing it. Also limits how deeply subexpressions
+// may be nested.
+#define HBS_MAX_OPERAND_DEPTH 32
+
+// Maximum nesting depth of partials whose names are computed at render time.
+// Other partials are inlined when their template set is linked.
+#define HBS_MAX_PARTIAL_DEPTH 16
+
+typedef struct HbsComponent HbsComponent;
+typedef struct HbsHelperRegistry HbsHelperRegistry;
+typedef struct HbsNaryTree HbsNaryTree;
+typedef struct HbsParser HbsParser;
+typedef struct HbsString HbsString;
+typedef struct HbsSymbolTable HbsSymbolTable;
+typedef struct HbsTemplateSet HbsTemplateSet;
+
+typedef enum HbsTemplateState {
+    HBS_TEMPLATE_UNLOADED,  // Lazy template which hasn't been parsed (yet)
+    HBS_TEMPLATE_READY,     // Components are loaded and may be rendered
+} HbsTemplateState;
+
+// Identifies the version of a file that a lazy template was created from.
+typedef struct HbsFingerprint {
+    off_t size;
+    struct timespec modified;
+} HbsFingerprint;
+
+// Totals of a single render, which are added to the statistics of its
+// template once it completes. Times are in nanoseconds.
+typedef struct HbsRenderCounts {
+    uint64_t time;
+    uint64_t bytes;
+    uint64_t handler_calls;
+    uint64_t handler_time;
+} HbsRenderCounts;
+
+// Statistics of a template (see hbs_template_stats()). Renders keep their own
+// totals, and add them here once, with relaxed atomics, so that concurrent
+// renders of the template don't contend on these. The sizes are measured
+// whenever the template is loaded.
+typedef struct HbsTemplateCounters {
+    atomic_uint_least64_t renders;
+    atomic_uint_least64_t render_time;
+    atomic_uint_least64_t max_render_time;
+    atomic_uint_least64_t bytes;
+    atomic_uint_least64_t handler_calls;
+    atomic_uint_least64_t handler_time;
+    atomic_size_t component_size;
+    atomic_size_t string_size;
+    atomic_size_t node_size;
+} HbsTemplateCounters;
+
+// This struct contains context necessary to parse the template and render it
+// using context.
+typedef struct HbsTemplate {
+    HbsNaryTree* components;
+
+    // Distinct keys referenced by the template. Every expression component's
+    // key_slot indexes into this table.
+    HbsSymbolTable* keys;
+
+    // Distinct path segments referenced by the template. The ids in each
+    // expression component's path index into this table.
+    HbsSymbolTable* segments;
+
+    // Helpers available to the template, if any. Lazy templates have none.
+    const HbsHelperRegistry* helpers;
+
+    // The set the template was linked in, if any, which resolves partials
+    // whose names are computed at render time.
+    HbsTemplateSet* set;
+
+    // Only kept for editable templates (those created with
+    // hbs_template_load_editable()). <outdated> is set if the source has been
+    // edited into a template that doesn't load, in which case the components
+    // are those of the last version that did.
+    HbsString* source;
+    bool outdated;
+
+    // Edits shift the offsets of the components after them lazily: the
+    // offsets of the components from <shift_position> onwards are short by
+    // <shift>, which wraps, so that it can move them back, too.
+    size_t shift_position;
+    size_t shift;
+
+    // The remaining members are only used by lazy templates (those created
+    // with hbs_template_load_lazy()), which are parsed from <path> on first
+    // use, and may be evicted back to the unloaded state.
+    char* path;
+    HbsFingerprint fingerprint;
+    atomic_int state;
+
+    // Number of renders in progress. Eviction is refused while it's non-zero.
+    atomic_size_t renders;
+
+    // Serializes parsing and eviction. Never taken once the template is ready.
+    pthread_mutex_t lock;
+
+#ifndef HBS_DISABLE_STATS
+    HbsTemplateCounters counters;
+#endif
+} HbsTemplate;
+
+// Intern the key of the expression <component> in <keys>, and split it into
+// path segments, which are interned in <segments>. If the expression names a
+// helper in <helpers> (which may be NULL), the keys of its arguments are
+// bound instead. Returns non-zero if a key is not a valid path, or memory
+// can't be allocated.
+int hbs_component_bind(HbsComponent* component, HbsSymbolTable* keys,
+    HbsSymbolTable* segments, const HbsHelperRegistry* helpers);
+
+// Create a template from <components>, which were produced by the parser (or
+// copied from components which were), taking ownership of them. Returns NULL
+// (and frees the components) if they can't be bound.
+HbsTemplate* hbs_template_from_components(HbsNaryTree* components,
+    const HbsHelperRegistry* helpers, HbsTemplateSet* set);
+
+// Called by each render before using the template, to ensure that it's been
+// loaded and to prevent it from being evicted. Returns non-zero if the
+// template could not be loaded.
+int hbs_template_acquire(HbsTemplate* template);
+
+// Called by each render once it's done with the template.
+void hbs_template_release(HbsTemplate* template);
+
+// Record the location of the parse error of <parser>, or that it had none, as
+// the outcome of the calling thread's most recent load, for
+// hbs_template_last_error(). Must be called before the parser's scanner is
+// freed.
+void hbs_template_record_error(const HbsParser* parser);
+
+// Add the totals of a completed render of <template> to its statistics.
+void hbs_template_count_render(HbsTemplate* template,
+    const HbsRenderCounts* counts);
+
+// Measure the memory used by the components of <template>, or clear the
+// measurements if it has none (e.g. once a lazy template is evicted).
+void hbs_template_measure(HbsTemplate* template);
+
+// Adjust the measurements of <template> after the components of <removed>
+// were replaced by the <count> components at <position>, without measuring
+// the rest of its components again.
+void hbs_template_measure_splice(HbsTemplate* template, size_t position,
+    size_t count, HbsNaryTree* removed);
+
+#endif // HANDLEBARS_TEMPLATE_H
+
+///////////////////////////////////////////////////////////////////////////////
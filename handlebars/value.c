@@ -0,0 +1,472 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            value.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Formatting of typed values produced by handlers.
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+////
+
+#include <math.h>
+#include <string.h>
+
+#include <handlebars/handlebars.h>
+
+// Large enough for any of the formatters below, including the sign, decimal
+// point, leading or trailing zeros and exponent.
+#define FORMAT_BUFFER_SIZE 40
+
+// Two ASCII digits for every value in [0, 100), so that integers are
+// converted two digits per division instead of one.
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Powers of ten which are exactly representable as a double.
+static const double POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13,
+    1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Integers up to 2^53 are exactly representable as a double.
+static const double MAX_EXACT_INTEGER = 9007199254740992.0;
+
+// Powers of ten which fit in a word of an HbsBigInt.
+static const uint32_t SMALL_POWERS_OF_TEN[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+    1000000000,
+};
+
+// Enough words for the exact arithmetic of the slow path, which needs just
+// over 1100 bits for the smallest and largest doubles.
+#define BIG_INT_WORDS 40
+
+// An unsigned integer in base 2^32, least significant word first, without
+// leading zero words.
+typedef struct HbsBigInt {
+    uint32_t words[BIG_INT_WORDS];
+    size_t length;
+} HbsBigInt;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+// Write the decimal representation of <value> into <buffer>, returning the
+// number of chars written. The buffer is not NUL-terminated.
+static size_t priv_format_uint64(char* buffer, uint64_t value) {
+    char digits[FORMAT_BUFFER_SIZE];
+    char* cursor = digits + sizeof(digits);
+    while (value >= 100) {
+        const size_t pair = (value % 100) * 2;
+        value /= 100;
+        cursor -= 2;
+        memcpy(cursor, DIGIT_PAIRS + pair, 2);
+    }
+
+    if (value >= 10) {
+        cursor -= 2;
+        memcpy(cursor, DIGIT_PAIRS + value * 2, 2);
+    } else {
+        *--cursor = (char)('0' + value);
+    }
+
+    const size_t length = digits + sizeof(digits) - cursor;
+    memcpy(buffer, cursor, length);
+    return length;
+}
+
+static size_t priv_format_int64(char* buffer, int64_t value) {
+    if (value < 0) {
+        buffer[0] = '-';
+        // Negate in unsigned arithmetic, so INT64_MIN doesn't overflow.
+        return 1 + priv_format_uint64(buffer + 1, -(uint64_t)value);
+    }
+    return priv_format_uint64(buffer, (uint64_t)value);
+}
+
+// Fast path for doubles with a short decimal expansion (which covers nearly
+// all currency amounts). Finds the smallest number of fractional digits that
+// round-trips to <value>, which is also the shortest representation. Returns
+// 0 if <value> is out of range for this method.
+static size_t priv_format_double_fixed(char* buffer, double value) {
+    const bool negative = value < 0;
+    const double magnitude = negative ? -value : value;
+    if (magnitude >= MAX_EXACT_INTEGER || magnitude < 1e-6) {
+        return 0;
+    }
+
+    for (size_t places = 0; places < 18; ++places) {
+        const double scaled = round(magnitude * POWERS_OF_TEN[places]);
+        if (scaled >= MAX_EXACT_INTEGER) {
+            return 0;
+        }
+
+        // Both operands are exact, so IEEE division yields the correctly
+        // rounded value of the decimal number, exactly as strtod() would.
+        if (scaled / POWERS_OF_TEN[places] != magnitude) {
+            continue;
+        }
+
+        char digits[FORMAT_BUFFER_SIZE];
+        size_t length = priv_format_uint64(digits, (uint64_t)scaled);
+        char* cursor = buffer;
+        if (negative) {
+            *cursor++ = '-';
+        }
+
+        if (0 == places) {
+            memcpy(cursor, digits, length);
+            return cursor + length - buffer;
+        }
+
+        if (length <= places) {
+            // e.g. 0.05: pad with leading zeros.
+            *cursor++ = '0';
+            *cursor++ = '.';
+            memset(cursor, '0', places - length);
+            cursor += places - length;
+            memcpy(cursor, digits, length);
+            return cursor + length - buffer;
+        }
+
+        memcpy(cursor, digits, length - places);
+        cursor += length - places;
+        *cursor++ = '.';
+        memcpy(cursor, digits + length - places, places);
+        return cursor + places - buffer;
+    }
+
+    return 0;
+}
+
+static void priv_big_set(HbsBigInt* big, uint64_t value) {
+    big->words[0] = (uint32_t)value;
+    big->words[1] = (uint32_t)(value >> 32);
+    big->length = 0 != big->words[1] ? 2 : (0 != big->words[0] ? 1 : 0);
+}
+
+static void priv_big_multiply(HbsBigInt* big, uint32_t factor) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < big->length; ++i) {
+        carry += (uint64_t)big->words[i] * factor;
+        big->words[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+
+    if (0 != carry) {
+        big->words[big->length++] = (uint32_t)carry;
+    }
+}
+
+static void priv_big_multiply_pow10(HbsBigInt* big, unsigned power) {
+    for (; power >= 9; power -= 9) {
+        priv_big_multiply(big, SMALL_POWERS_OF_TEN[9]);
+    }
+    priv_big_multiply(big, SMALL_POWERS_OF_TEN[power]);
+}
+
+static void priv_big_shift_left(HbsBigInt* big, unsigned bits) {
+    if (0 == big->length) {
+        return;
+    }
+
+    const unsigned shift = bits % 32;
+    if (0 != shift) {
+        uint32_t carry = 0;
+        for (size_t i = 0; i < big->length; ++i) {
+            const uint32_t word = big->words[i];
+            big->words[i] = (word << shift) | carry;
+            carry = word >> (32 - shift);
+        }
+        if (0 != carry) {
+            big->words[big->length++] = carry;
+        }
+    }
+
+    const size_t words = bits / 32;
+    if (0 != words) {
+        memmove(big->words + words, big->words,
+            big->length * sizeof(uint32_t));
+        memset(big->words, 0, words * sizeof(uint32_t));
+        big->length += words;
+    }
+}
+
+static int priv_big_compare(const HbsBigInt* first, const HbsBigInt* second)
+{
+    if (first->length != second->length) {
+        return first->length < second->length ? -1 : 1;
+    }
+
+    for (size_t i = first->length; 0 < i--;) {
+        if (first->words[i] != second->words[i]) {
+            return first->words[i] < second->words[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+static void priv_big_add(HbsBigInt* sum, const HbsBigInt* first,
+    const HbsBigInt* second)
+{
+    const size_t length = first->length > second->length
+        ? first->length : second->length;
+    uint64_t carry = 0;
+    for (size_t i = 0; i < length; ++i) {
+        carry += (uint64_t)(i < first->length ? first->words[i] : 0)
+            + (i < second->length ? second->words[i] : 0);
+        sum->words[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+
+    sum->length = length;
+    if (0 != carry) {
+        sum->words[sum->length++] = (uint32_t)carry;
+    }
+}
+
+// Subtract <second> from <first>, which must not be less than it.
+static void priv_big_subtract(HbsBigInt* first, const HbsBigInt* second) {
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < first->length; ++i) {
+        const uint64_t subtrahend = borrow
+            + (i < second->length ? second->words[i] : 0);
+        borrow = first->words[i] < subtrahend ? 1 : 0;
+        first->words[i] = (uint32_t)(first->words[i] - subtrahend);
+    }
+
+    while (0 < first->length && 0 == first->words[first->length - 1]) {
+        --first->length;
+    }
+}
+
+// Generate the shortest digits which read back as the positive, finite
+// <value>, with exact arithmetic (Burger and Dybvig's free-format algorithm),
+// and store the decimal exponent of the first digit in <power>. Returns the
+// number of digits.
+static size_t priv_shortest_digits(double value, char* digits, long* power) {
+    // value = mantissa * 2^exponent, where subnormals have the exponent of
+    // the smallest normal double.
+    int binary_power = 0;
+    const double fraction = frexp(value, &binary_power);
+    uint64_t mantissa = (uint64_t)ldexp(fraction, 53);
+    int exponent = binary_power - 53;
+    if (exponent < -1074) {
+        mantissa >>= -1074 - exponent;
+        exponent = -1074;
+    }
+
+    // The value is r / s, and the midpoints between it and its neighbours
+    // are (r - low) / s and (r + high) / s. The gap below a power of two is
+    // half of the gap above it. Those midpoints read back as the value itself
+    // if the mantissa is even (since reads round half to even).
+    const bool even = 0 == (mantissa & 1);
+    const bool narrow = (UINT64_C(1) << 52) == mantissa && exponent > -1074;
+    HbsBigInt r, s, high, low, sum;
+    priv_big_set(&r, mantissa << (narrow ? 2 : 1));
+    priv_big_set(&s, narrow ? 4 : 2);
+    priv_big_set(&high, narrow ? 2 : 1);
+    priv_big_set(&low, 1);
+    if (exponent >= 0) {
+        priv_big_shift_left(&r, exponent);
+        priv_big_shift_left(&high, exponent);
+        priv_big_shift_left(&low, exponent);
+    } else {
+        priv_big_shift_left(&s, -exponent);
+    }
+
+    // Scale by an estimate of the decimal exponent, which is exact or one too
+    // small, so that the digits start just after the decimal point.
+    long k = (long)ceil((binary_power - 1) * 0.30102999566398114 - 1e-10);
+    if (k >= 0) {
+        priv_big_multiply_pow10(&s, k);
+    } else {
+        priv_big_multiply_pow10(&r, -k);
+        priv_big_multiply_pow10(&high, -k);
+        priv_big_multiply_pow10(&low, -k);
+    }
+
+    priv_big_add(&sum, &r, &high);
+    const int too_small = priv_big_compare(&sum, &s);
+    if (even ? too_small >= 0 : too_small > 0) {
+        priv_big_multiply(&s, 10);
+        k += 1;
+    }
+
+    // Generate digits until the remainder is within the midpoints, then
+    // round the last one towards the value.
+    size_t length = 0;
+    for (;;) {
+        priv_big_multiply(&r, 10);
+        priv_big_multiply(&high, 10);
+        priv_big_multiply(&low, 10);
+        char digit = '0';
+        while (0 <= priv_big_compare(&r, &s)) {
+            priv_big_subtract(&r, &s);
+            ++digit;
+        }
+
+        priv_big_add(&sum, &r, &high);
+        const int below = priv_big_compare(&r, &low);
+        const int above = priv_big_compare(&sum, &s);
+        const bool round_down = even ? below <= 0 : below < 0;
+        const bool round_up = even ? above >= 0 : above > 0;
+        if (round_down && round_up) {
+            priv_big_shift_left(&r, 1);
+            digit += 0 <= priv_big_compare(&r, &s) ? 1 : 0;
+        } else if (round_up) {
+            digit += 1;
+        }
+
+        digits[length++] = digit;
+        if (round_down || round_up) {
+            break;
+        }
+    }
+
+    *power = k - 1;
+    return length;
+}
+
+// Slow path for very large, very small or very precise doubles. The digits
+// are laid out here, rather than by printf(), so the result doesn't depend on
+// the locale's decimal point.
+static size_t priv_format_double_slow(char* buffer, double value) {
+    char* cursor = buffer;
+    if (value < 0) {
+        *cursor++ = '-';
+        value = -value;
+    }
+
+    char digits[FORMAT_BUFFER_SIZE];
+    long power = 0;
+    const size_t length = priv_shortest_digits(value, digits, &power);
+
+    // Same layout rules as JavaScript's Number.prototype.toString()
+    if (power >= 21 || power < -6) {
+        *cursor++ = digits[0];
+        if (length > 1) {
+            *cursor++ = '.';
+            memcpy(cursor, digits + 1, length - 1);
+            cursor += length - 1;
+        }
+        *cursor++ = 'e';
+        *cursor++ = power < 0 ? '-' : '+';
+        cursor += priv_format_uint64(cursor, power < 0 ? -power : power);
+    } else if (power < 0) {
+        *cursor++ = '0';
+        *cursor++ = '.';
+        memset(cursor, '0', -power - 1);
+        cursor += -power - 1;
+        memcpy(cursor, digits, length);
+        cursor += length;
+    } else if ((size_t)power + 1 >= length) {
+        memcpy(cursor, digits, length);
+        cursor += length;
+        memset(cursor, '0', power + 1 - length);
+        cursor += power + 1 - length;
+    } else {
+        memcpy(cursor, digits, power + 1);
+        cursor += power + 1;
+        *cursor++ = '.';
+        memcpy(cursor, digits + power + 1, length - power - 1);
+        cursor += length - power - 1;
+    }
+
+    return cursor - buffer;
+}
+
+// Format <value> as the shortest string which round-trips, using the same
+// conventions as JavaScript (which handlebars templates generally expect).
+static size_t priv_format_double(char* buffer, double value) {
+    if (isnan(value)) {
+        memcpy(buffer, "NaN", 3);
+        return 3;
+    } else if (isinf(value)) {
+        if (value < 0) {
+            memcpy(buffer, "-Infinity", 9);
+            return 9;
+        }
+        memcpy(buffer, "Infinity", 8);
+        return 8;
+    } else if (0 == value) {
+        buffer[0] = '0'; // Also covers -0.0
+        return 1;
+    }
+
+    size_t length = priv_format_double_fixed(buffer, value);
+    if (0 == length) {
+        length = priv_format_double_slow(buffer, value);
+    }
+    return length;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+// Append the string representation of <value> to <string>.
+int hbs_string_append_value(HbsString* string, const HbsValue* value) {
+    char buffer[FORMAT_BUFFER_SIZE];
+    size_t length = 0;
+    switch (value->type) {
+    case HBS_VALUE_NULL:
+        return 0;
+    case HBS_VALUE_STRING:
+        if (NULL == value->string) {
+            return 0;
+        }
+        return hbs_string_append_str(string, value->string);
+    case HBS_VALUE_INT:
+        length = priv_format_int64(buffer, value->int_value);
+        break;
+    case HBS_VALUE_UINT:
+        length = priv_format_uint64(buffer, value->uint_value);
+        break;
+    case HBS_VALUE_DOUBLE:
+        length = priv_format_double(buffer, value->double_value);
+        break;
+    case HBS_VALUE_BOOL:
+        if (value->bool_value) {
+            return hbs_string_append_buffer(string, "true", 4);
+        }
+        return hbs_string_append_buffer(string, "false", 5);
+    default:
+        return 1;
+    }
+
+    return hbs_string_append_buffer(string, buffer, length);
+}
+
+///////////////////////////////////////////////////////////////////////////////
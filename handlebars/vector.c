@@ -7,7 +7,7 @@
 //
 // CREATED:         11/25/2021
 //
-// LAST EDITED:     01/06/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -47,7 +47,8 @@ static int hbs_priv_vector_extend(HbsVector* first, size_t needed_capacity) {
     size_t new_capacity = first->capacity;
     while (new_capacity < needed_capacity)
         new_capacity *= 2;
-    void* temp_vector = realloc(first->vector, new_capacity);
+    void* temp_vector = realloc(first->vector,
+        new_capacity * sizeof(void*));
     if (temp_vector == first->vector) {
         first->capacity = new_capacity;
         return 0;
@@ -7,7 +7,7 @@
 //
 // CREATED:         01/04/2022
 //
-// LAST EDITED:     01/06/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -30,7 +30,13 @@
 // IN THE SOFTWARE.
 ////
 
+// For mkstemp() and fdopen(), since the tests are built as strict C17.
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <unity_fixture.h>
 
@@ -69,8 +75,1478 @@ TEST(HbsTemplate, Basic) {
     hbs_input_context_free(input);
 }
 
+static HbsResult typed_value_handler(void* user_data __attribute__((unused)),
+    const char* key, HbsValue* value)
+{
+    if (!strcmp("int", key)) {
+        value->type = HBS_VALUE_INT;
+        value->int_value = -9223372036854775807 - 1;
+    } else if (!strcmp("uint", key)) {
+        value->type = HBS_VALUE_UINT;
+        value->uint_value = 18446744073709551615u;
+    } else if (!strcmp("amount", key)) {
+        value->type = HBS_VALUE_DOUBLE;
+        value->double_value = 1234.56;
+    } else if (!strcmp("small", key)) {
+        value->type = HBS_VALUE_DOUBLE;
+        value->double_value = 0.05;
+    } else if (!strcmp("huge", key)) {
+        value->type = HBS_VALUE_DOUBLE;
+        value->double_value = 1e300;
+    } else if (!strcmp("bool", key)) {
+        value->type = HBS_VALUE_BOOL;
+        value->bool_value = true;
+    } else if (!strcmp("string", key)) {
+        value->type = HBS_VALUE_STRING;
+        value->string = "text";
+    }
+    return HBS_OK;
+}
+
+static const char* TYPED_VALUE_TEST =
+    "{{int}} {{uint}} {{amount}} {{small}} {{huge}} {{bool}} {{null}}"
+    "{{string}}";
+TEST(HbsTemplate, TypedValue) {
+    HbsInputContext* input = hbs_input_context_from_string(TYPED_VALUE_TEST);
+    HbsTemplate* template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+
+    HbsHandlers handlers = {
+        .value_handler = typed_value_handler,
+        .key_handler_data = NULL,
+    };
+    HbsString* result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING("-9223372036854775808 18446744073709551615 "
+        "1234.56 0.05 1e+300 true text", result->string);
+
+    hbs_string_free(result);
+    hbs_template_free(template);
+    hbs_input_context_free(input);
+}
+
+static HbsResult double_value_handler(void* user_data, const char* key,
+    HbsValue* value)
+{
+    if (!strcmp("value", key)) {
+        value->type = HBS_VALUE_DOUBLE;
+        value->double_value = *(const double*)user_data;
+    }
+    return HBS_OK;
+}
+
+TEST(HbsTemplate, DoubleValue) {
+    static const struct {
+        double value;
+        const char* expected;
+    } cases[] = {
+        {5e-324, "5e-324"},
+        {1.7976931348623157e308, "1.7976931348623157e+308"},
+        {0.1 + 0.2, "0.30000000000000004"},
+        {1e21, "1e+21"},
+        {1e-7, "1e-7"},
+        {123456789012345680000.0, "123456789012345680000"},
+        {-2.5e-5, "-0.000025"},
+        {1.0 / 3.0, "0.3333333333333333"},
+    };
+
+    HbsInputContext* input = hbs_input_context_from_string("{{value}}");
+    HbsTemplate* template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(*cases); ++i) {
+        HbsHandlers handlers = {
+            .value_handler = double_value_handler,
+            .key_handler_data = (void*)&cases[i].value,
+        };
+        HbsString* result = hbs_template_render(template, &handlers);
+        TEST_ASSERT_NOT_NULL(result);
+        TEST_ASSERT_EQUAL_STRING(cases[i].expected, result->string);
+        hbs_string_free(result);
+    }
+
+    hbs_template_free(template);
+    hbs_input_context_free(input);
+}
+
+static HbsResult write_handler(void* user_data __attribute__((unused)),
+    const char* key, HbsString* output)
+{
+    TEST_ASSERT_EQUAL_STRING("list", key);
+    static const char* items[] = {"red", "green", "blue"};
+    for (size_t i = 0; i < sizeof(items) / sizeof(items[0]); ++i) {
+        if (0 != i) {
+            hbs_string_append_str(output, ", ");
+        }
+        hbs_string_append_str(output, items[i]);
+    }
+    return HBS_OK;
+}
+
+static const char* WRITE_HANDLER_TEST = "Colors: {{list}}.";
+TEST(HbsTemplate, WriteHandler) {
+    HbsInputContext* input = hbs_input_context_from_string(
+        WRITE_HANDLER_TEST);
+    HbsTemplate* template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+
+    HbsHandlers handlers = {
+        .write_handler = write_handler,
+        .key_handler_data = NULL,
+    };
+    HbsString* result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING("Colors: red, green, blue.", result->string);
+
+    hbs_string_free(result);
+    hbs_template_free(template);
+    hbs_input_context_free(input);
+}
+
+typedef struct MemoCounts {
+    int name;
+    int clock;
+} MemoCounts;
+
+static HbsResult memo_key_handler(void* user_data, const char* key,
+    const char** value)
+{
+    MemoCounts* counts = (MemoCounts*)user_data;
+    if (!strcmp("name", key)) {
+        counts->name += 1;
+        *value = "Jane";
+        return HBS_OK;
+    }
+
+    static const char* ticks[] = {"1", "2", "3"};
+    *value = ticks[counts->clock++ % 3];
+    return HBS_VOLATILE;
+}
+
+static const char* MEMOIZE_TEST = "{{name}}{{clock}} {{name}}{{clock}} "
+    "{{name}}{{clock}}";
+TEST(HbsTemplate, Memoize) {
+    HbsInputContext* input = hbs_input_context_from_string(MEMOIZE_TEST);
+    HbsTemplate* template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+
+    MemoCounts counts = {0};
+    HbsHandlers handlers = {
+        .key_handler = memo_key_handler,
+        .key_handler_data = &counts,
+        .memoize = true,
+    };
+    HbsString* result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING("Jane1 Jane2 Jane3", result->string);
+    TEST_ASSERT_EQUAL_INT(1, counts.name);
+    TEST_ASSERT_EQUAL_INT(3, counts.clock);
+    hbs_string_free(result);
+
+    // Without memoization, every occurrence is resolved.
+    handlers.memoize = false;
+    result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_INT(4, counts.name);
+
+    hbs_string_free(result);
+    hbs_template_free(template);
+    hbs_input_context_free(input);
+}
+
+typedef struct PrefetchState {
+    bool prefetched;
+    size_t lookups;
+} PrefetchState;
+
+static HbsResult prefetch_handler(void* user_data, const char* const* keys,
+    size_t length)
+{
+    PrefetchState* state = (PrefetchState*)user_data;
+    TEST_ASSERT_EQUAL_INT(0, state->lookups);
+    TEST_ASSERT_EQUAL_INT(3, length);
+    TEST_ASSERT_EQUAL_STRING("greeting", keys[0]);
+    TEST_ASSERT_EQUAL_STRING("name", keys[1]);
+    TEST_ASSERT_EQUAL_STRING("sign_off", keys[2]);
+    state->prefetched = true;
+    return HBS_OK;
+}
+
+static HbsResult prefetch_key_handler(void* user_data, const char* key,
+    const char** value)
+{
+    PrefetchState* state = (PrefetchState*)user_data;
+    TEST_ASSERT_TRUE(state->prefetched);
+    state->lookups += 1;
+    *value = key;
+    return HBS_OK;
+}
+
+static const char* PREFETCH_TEST =
+    "{{greeting}} {{name}}, {{name}}. {{sign_off}}";
+TEST(HbsTemplate, Prefetch) {
+    HbsInputContext* input = hbs_input_context_from_string(PREFETCH_TEST);
+    HbsTemplate* template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+
+    PrefetchState state = {0};
+    HbsHandlers handlers = {
+        .key_handler = prefetch_key_handler,
+        .key_handler_data = &state,
+        .prefetch = prefetch_handler,
+    };
+    HbsString* result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING("greeting name, name. sign_off", result->string);
+    TEST_ASSERT_EQUAL_INT(4, state.lookups);
+
+    hbs_string_free(result);
+    hbs_template_free(template);
+    hbs_input_context_free(input);
+}
+
+static HbsResult pending_key_handler(void* user_data, const char* key,
+    const char** value)
+{
+    // Every other call is pending, as if waiting on another process.
+    bool* ready = (bool*)user_data;
+    if (!*ready) {
+        *ready = true;
+        return HBS_PENDING;
+    }
+
+    *ready = false;
+    *value = key;
+    return HBS_OK;
+}
+
+static const char* PENDING_TEST = "{{one}} and {{two}}.";
+TEST(HbsTemplate, Pending) {
+    HbsInputContext* input = hbs_input_context_from_string(PENDING_TEST);
+    HbsTemplate* template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+
+    bool ready = false;
+    HbsHandlers handlers = {
+        .key_handler = pending_key_handler,
+        .key_handler_data = &ready,
+    };
+    HbsRender* render = hbs_render_new(template, &handlers);
+    TEST_ASSERT_NOT_NULL(render);
+    TEST_ASSERT_EQUAL_INT(HBS_PENDING, hbs_render_resume(render));
+    TEST_ASSERT_EQUAL_INT(HBS_PENDING, hbs_render_resume(render));
+    TEST_ASSERT_EQUAL_INT(HBS_OK, hbs_render_resume(render));
+
+    HbsString* result = hbs_render_take_output(render);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING("one and two.", result->string);
+    hbs_string_free(result);
+    hbs_render_free(render);
+
+    // The synchronous interface can't wait for pending values.
+    TEST_ASSERT_NULL(hbs_template_render(template, &handlers));
+
+    hbs_template_free(template);
+    hbs_input_context_free(input);
+}
+
+static const char* STEP_TEST = "The {{quick}} brown fox";
+TEST(HbsTemplate, Step) {
+    HbsInputContext* input = hbs_input_context_from_string(STEP_TEST);
+    HbsTemplate* template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+
+    HbsHandlers handlers = {
+        .key_handler = basic_key_handler,
+        .key_handler_data = NULL,
+    };
+    HbsRender* render = hbs_render_new(template, &handlers);
+    TEST_ASSERT_NOT_NULL(render);
+
+    // Three bytes at a time, so segments are split mid-component.
+    char output[64] = {0};
+    size_t length = 0;
+    size_t written = 0;
+    do {
+        TEST_ASSERT_EQUAL_INT(HBS_OK,
+            hbs_render_step(render, output + length, 3, &written));
+        TEST_ASSERT_TRUE(written <= 3);
+        length += written;
+    } while (0 != written);
+
+    TEST_ASSERT_EQUAL_STRING("The sneaky brown fox", output);
+    hbs_render_free(render);
+    hbs_template_free(template);
+    hbs_input_context_free(input);
+}
+
+TEST(HbsTemplate, Stream) {
+    // Long enough that the text is scanned in more than one piece.
+    HbsString* template = hbs_string_new();
+    HbsString* expected = hbs_string_new();
+    for (int i = 0; i < 1000; ++i) {
+        hbs_string_append_str(template, "The {{quick}} brown fox. ");
+        hbs_string_append_str(expected, "The sneaky brown fox. ");
+    }
+
+    HbsInputContext* input = hbs_input_context_from_string(template->string);
+    HbsString* result = hbs_string_new();
+    HbsOutputContext* output = hbs_output_context_from_string(result);
+    HbsHandlers handlers = {
+        .key_handler = basic_key_handler,
+        .key_handler_data = NULL,
+    };
+    TEST_ASSERT_EQUAL_INT(HBS_OK, hbs_render_stream(input, &handlers, output));
+    TEST_ASSERT_EQUAL_STRING(expected->string, result->string);
+
+    hbs_output_context_free(output);
+    hbs_input_context_free(input);
+    hbs_string_free(result);
+    hbs_string_free(expected);
+    hbs_string_free(template);
+}
+
+static const char* STREAM_ERROR_TEST = "The {{quick}} brown {{fox";
+TEST(HbsTemplate, StreamError) {
+    HbsInputContext* input = hbs_input_context_from_string(STREAM_ERROR_TEST);
+    HbsString* result = hbs_string_new();
+    HbsOutputContext* output = hbs_output_context_from_string(result);
+    HbsHandlers handlers = {
+        .key_handler = basic_key_handler,
+        .key_handler_data = NULL,
+    };
+    TEST_ASSERT_EQUAL_INT(HBS_ERROR,
+        hbs_render_stream(input, &handlers, output));
+
+    hbs_output_context_free(output);
+    hbs_input_context_free(input);
+    hbs_string_free(result);
+}
+
+TEST(HbsTemplate, LoadMany) {
+    enum { TEMPLATE_COUNT = 16 };
+    char paths[TEMPLATE_COUNT][32];
+    const char* path_list[TEMPLATE_COUNT + 1];
+    for (size_t i = 0; i < TEMPLATE_COUNT; ++i) {
+        strcpy(paths[i], "/tmp/hbs-test-XXXXXX");
+        int fd = mkstemp(paths[i]);
+        TEST_ASSERT_TRUE(-1 != fd);
+        FILE* file = fdopen(fd, "w");
+        fprintf(file, "Template %zu: {{quick}}", i);
+        fclose(file);
+        path_list[i] = paths[i];
+    }
+
+    // One of these doesn't exist, and should be reported as a failure.
+    path_list[TEMPLATE_COUNT] = "/tmp/hbs-test-does-not-exist";
+    HbsTemplate* templates[TEMPLATE_COUNT + 1];
+    TEST_ASSERT_EQUAL_INT(1, hbs_template_load_many(path_list,
+            TEMPLATE_COUNT + 1, 4, templates));
+    TEST_ASSERT_NULL(templates[TEMPLATE_COUNT]);
+
+    HbsHandlers handlers = {
+        .key_handler = basic_key_handler,
+        .key_handler_data = NULL,
+    };
+    for (size_t i = 0; i < TEMPLATE_COUNT; ++i) {
+        TEST_ASSERT_NOT_NULL(templates[i]);
+        HbsString* result = hbs_template_render(templates[i], &handlers);
+        char expected[64];
+        snprintf(expected, sizeof(expected), "Template %zu: sneaky", i);
+        TEST_ASSERT_EQUAL_STRING(expected, result->string);
+        hbs_string_free(result);
+        hbs_template_free(templates[i]);
+        unlink(paths[i]);
+    }
+}
+
+TEST(HbsTemplate, Lazy) {
+    char path[] = "/tmp/hbs-test-XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(-1 != fd);
+    FILE* file = fdopen(fd, "w");
+    fputs(BASIC_TEST, file);
+    fclose(file);
+
+    HbsTemplate* template = hbs_template_load_lazy(path);
+    TEST_ASSERT_NOT_NULL(template);
+    HbsHandlers handlers = {
+        .key_handler = basic_key_handler,
+        .key_handler_data = NULL,
+    };
+
+    // Can't be evicted while a render is in progress.
+    HbsRender* render = hbs_render_new(template, &handlers);
+    TEST_ASSERT_NOT_NULL(render);
+    TEST_ASSERT_EQUAL_INT(1, hbs_template_evict(template));
+    TEST_ASSERT_EQUAL_INT(HBS_OK, hbs_render_resume(render));
+    hbs_render_free(render);
+
+    // Once evicted, the template is parsed again on the next render.
+    TEST_ASSERT_EQUAL_INT(0, hbs_template_evict(template));
+    HbsString* result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING("The sneaky brown fox", result->string);
+    hbs_string_free(result);
+
+    // A file that changed since the template was created isn't loaded.
+    TEST_ASSERT_EQUAL_INT(0, hbs_template_evict(template));
+    file = fopen(path, "a");
+    fputs("!", file);
+    fclose(file);
+    TEST_ASSERT_NULL(hbs_template_render(template, &handlers));
+
+    hbs_template_free(template);
+    unlink(path);
+    TEST_ASSERT_NULL(hbs_template_load_lazy(path));
+}
+
+static HbsResult path_handler(void* user_data,
+    const HbsValue* context __attribute__((unused)), const HbsPath* path,
+    HbsValue* value)
+{
+    char* buffer = (char*)user_data;
+    buffer[0] = '\0';
+    for (size_t i = 0; i < path->length; ++i) {
+        if (0 != i) {
+            strcat(buffer, ">");
+        }
+        strcat(buffer, path->segments[i]);
+    }
+
+    value->type = HBS_VALUE_STRING;
+    value->string = buffer;
+    return HBS_OK;
+}
+
+static const char* PATH_TEST =
+    "{{order.customer.city}}|{{this.name}}|{{./name}}|{{this}}|{{order/id}}";
+TEST(HbsTemplate, Path) {
+    HbsInputContext* input = hbs_input_context_from_string(PATH_TEST);
+    HbsTemplate* template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+
+    size_t length = 0;
+    const char* const* segments = hbs_template_segments(template, &length);
+    TEST_ASSERT_EQUAL_INT(5, length);
+    TEST_ASSERT_EQUAL_STRING("order", segments[0]);
+    TEST_ASSERT_EQUAL_STRING("name", segments[3]);
+    TEST_ASSERT_EQUAL_STRING("id", segments[4]);
+
+    char buffer[64];
+    HbsHandlers handlers = {
+        .path_handler = path_handler,
+        .key_handler_data = buffer,
+    };
+    HbsString* result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING("order>customer>city|name|name||order>id",
+        result->string);
+
+    hbs_string_free(result);
+    hbs_template_free(template);
+    hbs_input_context_free(input);
+
+    static const char* invalid[] = {"{{a..b}}", "{{this.}}", "{{../a}}",
+        "{{a.}}"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        input = hbs_input_context_from_string(invalid[i]);
+        TEST_ASSERT_NULL(hbs_template_load(input));
+        hbs_input_context_free(input);
+    }
+}
+
+typedef struct BlockItem {
+    const char* name;
+    int64_t quantity;
+} BlockItem;
+
+typedef struct BlockOrder {
+    const char* customer;
+    const BlockItem* items;
+    size_t length;
+} BlockOrder;
+
+static const BlockItem BLOCK_ITEMS[] = {{"pen", 2}, {"ink", 1}};
+static const BlockOrder BLOCK_ORDER = {"Ann", BLOCK_ITEMS, 2};
+static const char* BLOCK_TAGS[] = {"new", "paid"};
+
+static HbsResult block_path_handler(void* user_data __attribute__((unused)),
+    const HbsValue* context, const HbsPath* path, HbsValue* value)
+{
+    TEST_ASSERT_EQUAL_INT(1, path->length);
+    const char* key = path->segments[0];
+    if (NULL == context) {
+        if (!strcmp("title", key)) {
+            value->type = HBS_VALUE_STRING;
+            value->string = "Orders";
+        } else if (!strcmp("order", key)) {
+            value->type = HBS_VALUE_OBJECT;
+            value->object.pointer = &BLOCK_ORDER;
+        } else if (!strcmp("tags", key)) {
+            value->type = HBS_VALUE_ARRAY;
+            value->object.pointer = BLOCK_TAGS;
+            value->object.length = 2;
+        }
+    } else if (&BLOCK_ORDER == context->object.pointer) {
+        if (!strcmp("customer", key)) {
+            value->type = HBS_VALUE_STRING;
+            value->string = BLOCK_ORDER.customer;
+        } else if (!strcmp("items", key)) {
+            value->type = HBS_VALUE_ARRAY;
+            value->object.pointer = BLOCK_ORDER.items;
+            value->object.length = BLOCK_ORDER.length;
+        }
+    } else {
+        const BlockItem* item = (const BlockItem*)context->object.pointer;
+        if (!strcmp("name", key)) {
+            value->type = HBS_VALUE_STRING;
+            value->string = item->name;
+        } else if (!strcmp("quantity", key)) {
+            value->type = HBS_VALUE_INT;
+            value->int_value = item->quantity;
+        }
+    }
+    return HBS_OK;
+}
+
+static HbsResult block_each_handler(void* user_data __attribute__((unused)),
+    const HbsValue* array, size_t index, HbsValue* element)
+{
+    if (BLOCK_TAGS == array->object.pointer) {
+        element->type = HBS_VALUE_STRING;
+        element->string = BLOCK_TAGS[index];
+    } else {
+        element->type = HBS_VALUE_OBJECT;
+        element->object.pointer = &BLOCK_ITEMS[index];
+    }
+    return HBS_OK;
+}
+
+static const char* BLOCK_TEST =
+    "{{title}}: {{#with order}}{{customer}} ({{../title}})"
+    "{{#each items}} [{{name}} x{{quantity}} for {{../customer}}]{{/each}}"
+    "{{/with}}{{#with missing}}never{{/with}}"
+    "{{#each tags}} <{{this}}>{{/each}}.";
+TEST(HbsTemplate, Block) {
+    HbsInputContext* input = hbs_input_context_from_string(BLOCK_TEST);
+    HbsTemplate* template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+
+    HbsHandlers handlers = {
+        .path_handler = block_path_handler,
+        .each_handler = block_each_handler,
+        .memoize = true,
+    };
+    HbsString* result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING("Orders: Ann (Orders) [pen x2 for Ann]"
+        " [ink x1 for Ann] <new> <paid>.", result->string);
+
+    hbs_string_free(result);
+    hbs_template_free(template);
+    hbs_input_context_free(input);
+
+    static const char* invalid[] = {"{{#with a}}", "{{/with}}",
+        "{{#with a}}{{/each}}", "{{#foo a}}{{/foo}}", "{{#with}}{{/with}}",
+        "{{../a}}", "{{#with a}}{{../../b}}{{/with}}", "{{a #b}}"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        input = hbs_input_context_from_string(invalid[i]);
+        TEST_ASSERT_NULL(hbs_template_load(input));
+        hbs_input_context_free(input);
+    }
+}
+
+static const char* DATA_VARIABLE_TEST =
+    "{{#each tags}}{{@index}}:{{this}}:{{@first}}:{{@last}}:{{@key}};{{/each}}"
+    "{{#with order}}{{#each items}}{{#with this}}{{@index}}{{/with}}{{/each}}"
+    "{{/with}}";
+TEST(HbsTemplate, DataVariable) {
+    HbsInputContext* input = hbs_input_context_from_string(
+        DATA_VARIABLE_TEST);
+    HbsTemplate* template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+
+    // Data variables aren't keys, so handlers never see them.
+    size_t length = 0;
+    hbs_template_keys(template, &length);
+    TEST_ASSERT_EQUAL_INT(4, length);
+
+    HbsHandlers handlers = {
+        .path_handler = block_path_handler,
+        .each_handler = block_each_handler,
+    };
+    HbsString* result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING("0:new:true:false:0;1:paid:false:true:1;01",
+        result->string);
+
+    hbs_string_free(result);
+    hbs_template_free(template);
+    hbs_input_context_free(input);
+
+    static const char* invalid[] = {"{{@index}}",
+        "{{#with a}}{{@index}}{{/with}}", "{{#each a}}{{@foo}}{{/each}}",
+        "{{#each @index}}{{/each}}"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        input = hbs_input_context_from_string(invalid[i]);
+        TEST_ASSERT_NULL(hbs_template_load(input));
+        hbs_input_context_free(input);
+    }
+}
+
+static HbsResult join_helper(void* data, size_t argc, const HbsValue* argv,
+    HbsString* output)
+{
+    for (size_t i = 0; i < argc; ++i) {
+        if ((0 < i && 0 != hbs_string_append_str(output, (const char*)data))
+            || 0 != hbs_string_append_value(output, &argv[i])) {
+            return HBS_ERROR;
+        }
+    }
+    return HBS_OK;
+}
+
+static const char* HELPER_TEST =
+    "{{join string \"a \\\"b\\\"\" 'c' 42 -1.5 true null int}}{{join}}"
+    "{{string}}";
+TEST(HbsTemplate, Helper) {
+    HbsHelperRegistry* registry = hbs_helper_registry_new();
+    TEST_ASSERT_NOT_NULL(registry);
+    TEST_ASSERT_EQUAL_INT(0, hbs_helper_registry_register(registry, "join",
+            join_helper, "|"));
+
+    HbsInputContext* input = hbs_input_context_from_string(HELPER_TEST);
+    HbsTemplate* template = hbs_template_load_with_helpers(input, registry);
+    TEST_ASSERT_NOT_NULL(template);
+
+    // The keys of the arguments are prefetched like any others.
+    size_t length = 0;
+    hbs_template_keys(template, &length);
+    TEST_ASSERT_EQUAL_INT(2, length);
+
+    HbsHandlers handlers = {
+        .value_handler = typed_value_handler,
+    };
+    HbsString* result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING(
+        "text|a \"b\"|c|42|-1.5|true||-9223372036854775808text",
+        result->string);
+
+    hbs_string_free(result);
+    hbs_template_free(template);
+    hbs_input_context_free(input);
+
+    // Only decimal numbers are literals. Anything else is a key.
+    input = hbs_input_context_from_string(
+        "{{join 0x10 inf 1x 2e2 -1.5E-1}}");
+    template = hbs_template_load_with_helpers(input, registry);
+    TEST_ASSERT_NOT_NULL(template);
+    hbs_input_context_free(input);
+    const char* const* keys = hbs_template_keys(template, &length);
+    TEST_ASSERT_EQUAL_INT(3, length);
+    TEST_ASSERT_EQUAL_STRING("0x10", keys[0]);
+    TEST_ASSERT_EQUAL_STRING("inf", keys[1]);
+    TEST_ASSERT_EQUAL_STRING("1x", keys[2]);
+    result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING("|||200|-0.15", result->string);
+    hbs_string_free(result);
+    hbs_template_free(template);
+
+    static const char* invalid[] = {"{{nope a}}", "{{join \"a}}",
+        "{{join @index}}", "{{join a..b}}"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        input = hbs_input_context_from_string(invalid[i]);
+        TEST_ASSERT_NULL(hbs_template_load_with_helpers(input, registry));
+        hbs_input_context_free(input);
+    }
+
+    // Without the registry, the helper is just an invalid expression.
+    input = hbs_input_context_from_string(HELPER_TEST);
+    TEST_ASSERT_NULL(hbs_template_load(input));
+    hbs_input_context_free(input);
+    hbs_helper_registry_free(registry);
+}
+
+static HbsResult upper_helper(void* data __attribute__((unused)),
+    size_t argc, const HbsValue* argv, HbsString* output)
+{
+    if (1 != argc || HBS_VALUE_STRING != argv[0].type) {
+        return HBS_ERROR;
+    }
+
+    const size_t start = output->length;
+    if (0 != hbs_string_append_str(output, argv[0].string)) {
+        return HBS_ERROR;
+    }
+    for (size_t i = start; i < output->length; ++i) {
+        if ('a' <= output->string[i] && 'z' >= output->string[i]) {
+            output->string[i] -= 'a' - 'A';
+        }
+    }
+    return HBS_OK;
+}
+
+static const char* SUBEXPRESSION_TEST =
+    "{{join (upper string) (join 1 (upper (join 'x' string)) 2) int}}"
+    "{{upper (join)}}.";
+TEST(HbsTemplate, Subexpression) {
+    HbsHelperRegistry* registry = hbs_helper_registry_new();
+    TEST_ASSERT_NOT_NULL(registry);
+    TEST_ASSERT_EQUAL_INT(0, hbs_helper_registry_register(registry, "join",
+            join_helper, "-"));
+    TEST_ASSERT_EQUAL_INT(0, hbs_helper_registry_register(registry, "upper",
+            upper_helper, NULL));
+
+    HbsInputContext* input = hbs_input_context_from_string(
+        SUBEXPRESSION_TEST);
+    HbsTemplate* template = hbs_template_load_with_helpers(input, registry);
+    TEST_ASSERT_NOT_NULL(template);
+
+    HbsHandlers handlers = {
+        .value_handler = typed_value_handler,
+    };
+    HbsString* result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING("TEXT-1-X-TEXT-2--9223372036854775808.",
+        result->string);
+
+    hbs_string_free(result);
+    hbs_template_free(template);
+    hbs_input_context_free(input);
+
+    static const char* invalid[] = {"{{join (upper a}}", "{{join upper a)}}",
+        "{{join (nope a)}}", "{{join ()}}", "{{(upper a)}}",
+        "{{#with (upper a)}}{{/with}}"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        input = hbs_input_context_from_string(invalid[i]);
+        TEST_ASSERT_NULL(hbs_template_load_with_helpers(input, registry));
+        hbs_input_context_free(input);
+    }
+    hbs_helper_registry_free(registry);
+}
+
+static HbsResult counting_helper(void* data, size_t argc,
+    const HbsValue* argv, HbsString* output)
+{
+    *(size_t*)data += 1;
+    return join_helper("", argc, argv, output);
+}
+
+static const char* PURE_HELPER_TEST =
+    "{{pure 'a' 1}}{{pure 'a' 1}}{{pure 'a' '1'}}{{impure 'a'}}";
+TEST(HbsTemplate, PureHelper) {
+    HbsHelperRegistry* registry = hbs_helper_registry_new();
+    TEST_ASSERT_NOT_NULL(registry);
+    size_t pure_calls = 0;
+    size_t impure_calls = 0;
+    TEST_ASSERT_EQUAL_INT(0, hbs_helper_registry_register_with_flags(
+            registry, "pure", counting_helper, &pure_calls,
+            HBS_HELPER_PURE));
+    TEST_ASSERT_EQUAL_INT(0, hbs_helper_registry_register(registry,
+            "impure", counting_helper, &impure_calls));
+
+    // The cache is shared by both templates.
+    HbsTemplate* templates[2];
+    for (size_t i = 0; i < 2; ++i) {
+        HbsInputContext* input = hbs_input_context_from_string(
+            PURE_HELPER_TEST);
+        templates[i] = hbs_template_load_with_helpers(input, registry);
+        TEST_ASSERT_NOT_NULL(templates[i]);
+        hbs_input_context_free(input);
+
+        HbsHandlers handlers = {0};
+        HbsString* result = hbs_template_render(templates[i], &handlers);
+        TEST_ASSERT_NOT_NULL(result);
+        TEST_ASSERT_EQUAL_STRING("a1a1a1a", result->string);
+        hbs_string_free(result);
+    }
+
+    TEST_ASSERT_EQUAL_INT(2, pure_calls);
+    TEST_ASSERT_EQUAL_INT(2, impure_calls);
+    HbsHelperCacheStats stats;
+    hbs_helper_registry_cache_stats(registry, &stats);
+    TEST_ASSERT_EQUAL_INT(4, stats.hits);
+    TEST_ASSERT_EQUAL_INT(2, stats.misses);
+    TEST_ASSERT_EQUAL_INT(2, stats.entries);
+
+    // Results of a helper aren't reused once it's registered again.
+    TEST_ASSERT_EQUAL_INT(0, hbs_helper_registry_register_with_flags(
+            registry, "pure", join_helper, "-", HBS_HELPER_PURE));
+    HbsHandlers handlers = {0};
+    HbsString* result = hbs_template_render(templates[0], &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING("a-1a-1a-1a", result->string);
+    hbs_string_free(result);
+    TEST_ASSERT_EQUAL_INT(2, pure_calls);
+
+    hbs_helper_registry_set_cache_capacity(registry, 0);
+    hbs_helper_registry_cache_stats(registry, &stats);
+    TEST_ASSERT_EQUAL_INT(0, stats.entries);
+    TEST_ASSERT_EQUAL_INT(0, stats.size);
+    TEST_ASSERT_EQUAL_INT(4, stats.evictions);
+
+    for (size_t i = 0; i < 2; ++i) {
+        hbs_template_free(templates[i]);
+    }
+    hbs_helper_registry_free(registry);
+}
+
+static void template_set_add(HbsTemplateSet* set, const char* name,
+    const char* template)
+{
+    HbsInputContext* input = hbs_input_context_from_string(template);
+    TEST_ASSERT_EQUAL_INT(0, hbs_template_set_add(set, name, input));
+    hbs_input_context_free(input);
+}
+
+static void template_set_render(HbsTemplateSet* set, const char* name,
+    const char* expected)
+{
+    HbsHandlers handlers = {
+        .path_handler = block_path_handler,
+        .each_handler = block_each_handler,
+    };
+    HbsTemplate* template = hbs_template_set_get(set, name);
+    TEST_ASSERT_NOT_NULL(template);
+    HbsString* result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING(expected, result->string);
+    hbs_string_free(result);
+}
+
+TEST(HbsTemplate, TemplateSet) {
+    HbsHelperRegistry* registry = hbs_helper_registry_new();
+    TEST_ASSERT_NOT_NULL(registry);
+    TEST_ASSERT_EQUAL_INT(0, hbs_helper_registry_register(registry, "join",
+            join_helper, ""));
+
+    HbsTemplateSet* set = hbs_template_set_new(registry);
+    TEST_ASSERT_NOT_NULL(set);
+    template_set_add(set, "page",
+        "{{> header}}:{{> customer order}}{{> (join 'tag-' 'x')}}.");
+    template_set_add(set, "header", "[{{title}}]");
+    template_set_add(set, "tag-x", "X{{title}}");
+
+    // The customer partial refers to the enclosing context, so it can only be
+    // rendered as a partial.
+    template_set_add(set, "customer", "{{customer}} ({{../title}})");
+    TEST_ASSERT_EQUAL_INT(1, hbs_template_set_link(set));
+    TEST_ASSERT_NULL(hbs_template_set_get(set, "customer"));
+    template_set_render(set, "page", "[Orders]:Ann (Orders)XOrders.");
+
+    // Only the templates which include the header are relinked.
+    HbsTemplate* tag = hbs_template_set_get(set, "tag-x");
+    template_set_add(set, "header", "<{{title}}>");
+    TEST_ASSERT_EQUAL_INT(0, hbs_template_set_link(set));
+    TEST_ASSERT_EQUAL_PTR(tag, hbs_template_set_get(set, "tag-x"));
+    template_set_render(set, "page", "<Orders>:Ann (Orders)XOrders.");
+
+    // Missing and recursive partials can't be linked.
+    template_set_add(set, "missing", "{{> nope}}");
+    template_set_add(set, "loop", "a{{> loop}}");
+    TEST_ASSERT_EQUAL_INT(2, hbs_template_set_link(set));
+    TEST_ASSERT_NULL(hbs_template_set_get(set, "missing"));
+    TEST_ASSERT_NULL(hbs_template_set_get(set, "loop"));
+    hbs_template_set_free(set);
+
+    // Partials are only available within a set.
+    HbsInputContext* input = hbs_input_context_from_string("{{> header}}");
+    TEST_ASSERT_NULL(hbs_template_load(input));
+    hbs_input_context_free(input);
+    hbs_helper_registry_free(registry);
+}
+
+typedef struct PendingPartialState {
+    bool ready;
+    size_t prefetches;
+} PendingPartialState;
+
+static HbsResult pending_partial_prefetch(void* user_data,
+    const char* const* keys, size_t length)
+{
+    (void)keys;
+    (void)length;
+    ((PendingPartialState*)user_data)->prefetches += 1;
+    return HBS_OK;
+}
+
+static HbsResult pending_partial_key_handler(void* user_data,
+    const char* key, const char** value)
+{
+    PendingPartialState* state = (PendingPartialState*)user_data;
+    return pending_key_handler(&state->ready, key, value);
+}
+
+TEST(HbsTemplate, PendingPartial) {
+    HbsHelperRegistry* registry = hbs_helper_registry_new();
+    TEST_ASSERT_NOT_NULL(registry);
+    TEST_ASSERT_EQUAL_INT(0, hbs_helper_registry_register(registry, "join",
+            join_helper, ""));
+
+    HbsTemplateSet* set = hbs_template_set_new(registry);
+    TEST_ASSERT_NOT_NULL(set);
+    template_set_add(set, "page", "<{{> (join 'tag-' 'x')}}>");
+    template_set_add(set, "tag-x", "{{one}} and {{two}}");
+    TEST_ASSERT_EQUAL_INT(0, hbs_template_set_link(set));
+
+    // The render of the partial is suspended along with the page, and the
+    // prefetch handler is only called for the page.
+    PendingPartialState state = {0};
+    HbsHandlers handlers = {
+        .key_handler = pending_partial_key_handler,
+        .key_handler_data = &state,
+        .prefetch = pending_partial_prefetch,
+    };
+    HbsRender* render = hbs_render_new(hbs_template_set_get(set, "page"),
+        &handlers);
+    TEST_ASSERT_NOT_NULL(render);
+    TEST_ASSERT_EQUAL_INT(HBS_PENDING, hbs_render_resume(render));
+    TEST_ASSERT_EQUAL_INT(HBS_PENDING, hbs_render_resume(render));
+    TEST_ASSERT_EQUAL_INT(HBS_OK, hbs_render_resume(render));
+    TEST_ASSERT_EQUAL_INT(1, state.prefetches);
+
+    HbsString* result = hbs_render_take_output(render);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING("<one and two>", result->string);
+    hbs_string_free(result);
+    hbs_render_free(render);
+
+    // A render suspended within a partial can also be abandoned.
+    render = hbs_render_new(hbs_template_set_get(set, "page"), &handlers);
+    TEST_ASSERT_NOT_NULL(render);
+    TEST_ASSERT_EQUAL_INT(HBS_PENDING, hbs_render_resume(render));
+    hbs_render_free(render);
+
+    hbs_template_set_free(set);
+    hbs_helper_registry_free(registry);
+}
+
+TEST(HbsTemplate, Layout) {
+    HbsTemplateSet* set = hbs_template_set_new(NULL);
+    TEST_ASSERT_NOT_NULL(set);
+    template_set_add(set, "base",
+        "<title>{{#> head}}Site{{/head}}</title>{{> @partial-block}}");
+    template_set_add(set, "layout",
+        "{{#> base}}{{#*inline \"head\"}}{{title}} - Site{{/inline}}"
+        "<main>{{#> body}}Empty{{/body}}</main>{{/base}}");
+    template_set_add(set, "page",
+        "{{#> layout}}{{#*inline 'body'}}{{> item order}}!{{/inline}}"
+        "{{/layout}}");
+    template_set_add(set, "item", "{{customer}}");
+
+    // The base layout can't be rendered outside of a partial block.
+    TEST_ASSERT_EQUAL_INT(1, hbs_template_set_link(set));
+    TEST_ASSERT_NULL(hbs_template_set_get(set, "base"));
+    template_set_render(set, "layout",
+        "<title>Orders - Site</title><main>Empty</main>");
+    template_set_render(set, "page",
+        "<title>Orders - Site</title><main>Ann!</main>");
+
+    // Overrides take precedence over the partials of the set.
+    template_set_add(set, "head", "Head");
+    template_set_add(set, "plain", "{{#> base}}{{/base}}");
+    TEST_ASSERT_EQUAL_INT(1, hbs_template_set_link(set));
+    template_set_render(set, "plain", "<title>Head</title>");
+    template_set_render(set, "page",
+        "<title>Orders - Site</title><main>Ann!</main>");
+
+    // Partial blocks must be closed, and inline partials must be quoted.
+    template_set_add(set, "open", "{{#> base}}a{{/layout}}");
+    template_set_add(set, "unquoted",
+        "{{#> base}}{{#*inline head}}a{{/inline}}{{/base}}");
+    TEST_ASSERT_EQUAL_INT(2, hbs_template_set_link(set));
+    TEST_ASSERT_NULL(hbs_template_set_get(set, "open"));
+    TEST_ASSERT_NULL(hbs_template_set_get(set, "unquoted"));
+    hbs_template_set_free(set);
+
+    HbsInputContext* input = hbs_input_context_from_string(
+        "{{#> base}}a{{/base}}");
+    TEST_ASSERT_NULL(hbs_template_load(input));
+    hbs_input_context_free(input);
+}
+
+TEST(HbsTemplate, Specialize) {
+    HbsInputContext* input = hbs_input_context_from_string(
+        "<{{name}}>{{clock}} {{name}}{{clock}}");
+    HbsTemplate* template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+    hbs_input_context_free(input);
+
+    // Each constant key is resolved once, and disappears from the template.
+    MemoCounts counts = {0};
+    HbsHandlers handlers = {
+        .key_handler = memo_key_handler,
+        .key_handler_data = &counts,
+    };
+    HbsTemplate* specialized = hbs_template_specialize(template, &handlers);
+    TEST_ASSERT_NOT_NULL(specialized);
+    TEST_ASSERT_EQUAL_INT(1, counts.name);
+    size_t length = 0;
+    const char* const* keys = hbs_template_keys(specialized, &length);
+    TEST_ASSERT_EQUAL_INT(1, length);
+    TEST_ASSERT_EQUAL_STRING("clock", keys[0]);
+
+    HbsString* result = hbs_template_render(specialized, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING("<Jane>2 Jane3", result->string);
+    TEST_ASSERT_EQUAL_INT(1, counts.name);
+    hbs_string_free(result);
+    hbs_template_free(specialized);
+
+    // Keys within blocks are only folded if they refer to the top level.
+    hbs_template_free(template);
+    input = hbs_input_context_from_string(
+        "{{#with order}}{{../title}}: {{customer}}{{/with}}");
+    template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+    hbs_input_context_free(input);
+    handlers = (HbsHandlers){
+        .path_handler = block_path_handler,
+        .each_handler = block_each_handler,
+    };
+    specialized = hbs_template_specialize(template, &handlers);
+    TEST_ASSERT_NOT_NULL(specialized);
+    keys = hbs_template_keys(specialized, &length);
+    TEST_ASSERT_EQUAL_INT(2, length);
+    TEST_ASSERT_EQUAL_STRING("order", keys[0]);
+    TEST_ASSERT_EQUAL_STRING("customer", keys[1]);
+    result = hbs_template_render(specialized, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING("Orders: Ann", result->string);
+    hbs_string_free(result);
+    hbs_template_free(specialized);
+    hbs_template_free(template);
+}
+
+typedef struct Readings {
+    const char* temp;
+    const char* unit;
+    const char* hum;
+    size_t lookups;
+} Readings;
+
+static HbsResult readings_handler(void* user_data, const char* key,
+    HbsValue* value)
+{
+    Readings* readings = user_data;
+    readings->lookups += 1;
+    value->type = HBS_VALUE_STRING;
+    value->string = !strcmp("temp", key) ? readings->temp
+        : !strcmp("unit", key) ? readings->unit : readings->hum;
+    return HBS_OK;
+}
+
+static void rerender(HbsTemplate* template, HbsHandlers* handlers,
+    HbsString* output, HbsSpanMap* spans, size_t changed,
+    const char* expected)
+{
+    TEST_ASSERT_EQUAL_INT(0, hbs_template_rerender(template, handlers, output,
+            spans, &changed, 1));
+    TEST_ASSERT_EQUAL_STRING(expected, output->string);
+    TEST_ASSERT_EQUAL_INT(strlen(expected), output->length);
+}
+
+TEST(HbsTemplate, Rerender) {
+    HbsInputContext* input = hbs_input_context_from_string(
+        "{{temp}}{{unit}} / {{hum}}% ({{temp}}){{#with unit}}!{{/with}}");
+    HbsTemplate* template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+    hbs_input_context_free(input);
+
+    Readings readings = {.temp = "21", .unit = "C", .hum = "40"};
+    HbsHandlers handlers = {
+        .value_handler = readings_handler,
+        .key_handler_data = &readings,
+    };
+    HbsSpanMap* spans = NULL;
+    HbsString* output = hbs_template_render_spans(template, &handlers,
+        &spans);
+    TEST_ASSERT_NOT_NULL(output);
+    TEST_ASSERT_NOT_NULL(spans);
+    TEST_ASSERT_EQUAL_STRING("21C / 40% (21)!", output->string);
+
+    // Keys are numbered in order of first appearance: temp, unit, hum. Only
+    // the changed key is resolved, once for all of its expressions.
+    readings.lookups = 0;
+    readings.temp = "22";
+    rerender(template, &handlers, output, spans, 0, "22C / 40% (22)!");
+    readings.hum = "5";
+    rerender(template, &handlers, output, spans, 2, "22C / 5% (22)!");
+    readings.temp = "100";
+    rerender(template, &handlers, output, spans, 0, "100C / 5% (100)!");
+    readings.hum = "45";
+    rerender(template, &handlers, output, spans, 2, "100C / 45% (100)!");
+    TEST_ASSERT_EQUAL_INT(4, readings.lookups);
+
+    // The unit is also the key of a block, so the template is rendered again.
+    readings.unit = "";
+    rerender(template, &handlers, output, spans, 1, "100 / 45% (100)!");
+    TEST_ASSERT_EQUAL_INT(9, readings.lookups);
+    readings.temp = "7";
+    rerender(template, &handlers, output, spans, 0, "7 / 45% (7)!");
+
+    // Changing several keys at once, some growing and some shrinking, moves
+    // the bytes in between in both directions.
+    const size_t both[] = {0, 2};
+    readings.temp = "1000";
+    readings.hum = "";
+    TEST_ASSERT_EQUAL(0, hbs_template_rerender(template, &handlers, output,
+            spans, both, 2));
+    TEST_ASSERT_EQUAL_STRING("1000 / % (1000)!", output->string);
+    readings.temp = "1";
+    readings.hum = "12345";
+    TEST_ASSERT_EQUAL(0, hbs_template_rerender(template, &handlers, output,
+            spans, both, 2));
+    TEST_ASSERT_EQUAL_STRING("1 / 12345% (1)!", output->string);
+    TEST_ASSERT_EQUAL_INT(strlen(output->string), output->length);
+    readings.temp = "-40";
+    rerender(template, &handlers, output, spans, 0, "-40 / 12345% (-40)!");
+
+    size_t changed = 3;
+    TEST_ASSERT_NOT_EQUAL(0, hbs_template_rerender(template, &handlers,
+            output, spans, &changed, 1));
+    hbs_span_map_free(spans);
+    hbs_string_free(output);
+    hbs_template_free(template);
+}
+
+static void render_edited(HbsTemplate* template, const char* expected) {
+    HbsHandlers handlers = {
+        .path_handler = block_path_handler,
+        .each_handler = block_each_handler,
+    };
+    HbsString* result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING(expected, result->string);
+    hbs_string_free(result);
+}
+
+TEST(HbsTemplate, Edit) {
+    HbsInputContext* input = hbs_input_context_from_string("Hi {{title}}.");
+    HbsTemplate* template = hbs_template_load_editable(input, NULL);
+    TEST_ASSERT_NOT_NULL(template);
+    hbs_input_context_free(input);
+    render_edited(template, "Hi Orders.");
+
+    TEST_ASSERT_EQUAL_INT(0, hbs_template_apply_edit(template, 0, 2, "Hello",
+            5));
+    render_edited(template, "Hello Orders.");
+
+    // Until the block is closed, the last version that loaded is rendered.
+    static const char* block = "{{#with order}} {{customer}}";
+    TEST_ASSERT_NOT_EQUAL(0, hbs_template_apply_edit(template, 15, 0,
+            block, strlen(block)));
+    render_edited(template, "Hello Orders.");
+    TEST_ASSERT_EQUAL_INT(0, hbs_template_apply_edit(template, 43, 0,
+            "{{/with}}", 9));
+    render_edited(template, "Hello Orders Ann.");
+
+    TEST_ASSERT_EQUAL_INT(0, hbs_template_apply_edit(template, 30, 1, ", ",
+            2));
+    render_edited(template, "Hello Orders, Ann.");
+    TEST_ASSERT_NOT_EQUAL(0, hbs_template_apply_edit(template, 13, 2, "",
+            0));
+    render_edited(template, "Hello Orders, Ann.");
+    TEST_ASSERT_EQUAL_INT(0, hbs_template_apply_edit(template, 13, 0, "}}",
+            2));
+    TEST_ASSERT_EQUAL_INT(0, hbs_template_apply_edit(template, 34, 8,
+            "../title", 8));
+    render_edited(template, "Hello Orders, Orders.");
+    TEST_ASSERT_NOT_EQUAL(0, hbs_template_apply_edit(template, 44, 9, "", 0));
+    render_edited(template, "Hello Orders, Orders.");
+
+    TEST_ASSERT_NOT_EQUAL(0, hbs_template_apply_edit(template, 100, 0,
+            "", 0));
+    hbs_template_free(template);
+
+    // Templates which weren't loaded for editing can't be edited.
+    input = hbs_input_context_from_string("Hi {{title}}.");
+    template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+    hbs_input_context_free(input);
+    TEST_ASSERT_NOT_EQUAL(0, hbs_template_apply_edit(template, 0, 2, "Yo",
+            2));
+    hbs_template_free(template);
+}
+
+// Apply an edit at the first occurrence of <at> to both <template> and the
+// copy of its source, <source>.
+static int edit_source(HbsTemplate* template, HbsString* source,
+    const char* at, size_t removed, const char* inserted)
+{
+    const char* found = strstr(source->string, at);
+    TEST_ASSERT_NOT_NULL(found);
+    const size_t offset = found - source->string;
+    TEST_ASSERT_EQUAL_INT(0, hbs_string_replace(source, offset, removed,
+            inserted, strlen(inserted)));
+    return hbs_template_apply_edit(template, offset, removed, inserted,
+        strlen(inserted));
+}
+
+// Check that the edited <template> measures the same as one loaded from its
+// <source>, if statistics are enabled.
+static void check_edited_size(HbsTemplate* template, const HbsString* source)
+{
+    HbsInputContext* input = hbs_input_context_from_string(source->string);
+    HbsTemplate* loaded = hbs_template_load_editable(input, NULL);
+    TEST_ASSERT_NOT_NULL(loaded);
+    hbs_input_context_free(input);
+
+    HbsTemplateStats edited_stats;
+    HbsTemplateStats loaded_stats;
+    if (0 == hbs_template_stats(template, &edited_stats)) {
+        TEST_ASSERT_EQUAL_INT(0, hbs_template_stats(loaded, &loaded_stats));
+        TEST_ASSERT_EQUAL_INT(loaded_stats.component_size,
+            edited_stats.component_size);
+        TEST_ASSERT_EQUAL_INT(loaded_stats.string_size,
+            edited_stats.string_size);
+    }
+    hbs_template_free(loaded);
+}
+
+TEST(HbsTemplate, EditBlock) {
+    HbsInputContext* input = hbs_input_context_from_string(BLOCK_TEST);
+    HbsTemplate* template = hbs_template_load_editable(input, NULL);
+    TEST_ASSERT_NOT_NULL(template);
+    hbs_input_context_free(input);
+    HbsString* source = hbs_string_from_str(BLOCK_TEST);
+    TEST_ASSERT_NOT_NULL(source);
+
+    // Edits within the blocks only pair up the blocks around them.
+    TEST_ASSERT_EQUAL_INT(0, edit_source(template, source, " [{{name}}", 2,
+            " ("));
+    TEST_ASSERT_EQUAL_INT(0, edit_source(template, source, "]{{/each}}", 1,
+            ")"));
+    TEST_ASSERT_EQUAL_INT(0, edit_source(template, source, "{{quantity}}",
+            12, "{{@index}}"));
+    render_edited(template, "Orders: Ann (Orders) (pen x0 for Ann)"
+        " (ink x1 for Ann) <new> <paid>.");
+    check_edited_size(template, source);
+
+    // The offsets of the components after an edit are shifted as later edits
+    // come across them.
+    TEST_ASSERT_EQUAL_INT(0, edit_source(template, source, "{{title}}: ", 11,
+            "{{title}} - "));
+    TEST_ASSERT_EQUAL_INT(0, edit_source(template, source,
+            "{{#with missing}}", 31, ""));
+    TEST_ASSERT_EQUAL_INT(0, edit_source(template, source, "{{/each}}.", 10,
+            "{{/each}}!"));
+    TEST_ASSERT_EQUAL_INT(0, edit_source(template, source, " (", 2, " <"));
+    render_edited(template, "Orders - Ann <Orders) (pen x0 for Ann)"
+        " (ink x1 for Ann) <new> <paid>!");
+    check_edited_size(template, source);
+
+    // Failed edits leave the blocks as they were.
+    TEST_ASSERT_NOT_EQUAL(0, edit_source(template, source, "{{../title}}",
+            12, "{{../../title}}"));
+    render_edited(template, "Orders - Ann <Orders) (pen x0 for Ann)"
+        " (ink x1 for Ann) <new> <paid>!");
+    TEST_ASSERT_EQUAL_INT(0, edit_source(template, source, "{{../../title}}",
+            15, "{{../title}}"));
+    TEST_ASSERT_NOT_EQUAL(0, edit_source(template, source,
+            "{{/each}}{{/with}}", 18, "{{/each}}"));
+    render_edited(template, "Orders - Ann <Orders) (pen x0 for Ann)"
+        " (ink x1 for Ann) <new> <paid>!");
+    TEST_ASSERT_EQUAL_INT(0, edit_source(template, source,
+            "{{/each}}{{#each tags}}", 9, "{{/each}}{{/with}}"));
+    render_edited(template, "Orders - Ann <Orders) (pen x0 for Ann)"
+        " (ink x1 for Ann) <new> <paid>!");
+    check_edited_size(template, source);
+
+    hbs_string_free(source);
+    hbs_template_free(template);
+}
+
+TEST(HbsTemplate, Budget) {
+    HbsInputContext* input = hbs_input_context_from_string(BASIC_TEST);
+    HbsTemplate* template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+    hbs_input_context_free(input);
+
+    HbsHandlers handlers = {
+        .key_handler = basic_key_handler,
+        .max_output_length = 20,
+    };
+    HbsString* result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING("The sneaky brown fox", result->string);
+    hbs_string_free(result);
+
+    // The output is freed as soon as the render exceeds the limit, and the
+    // render can't be resumed.
+    handlers.max_output_length = 10;
+    HbsRender* render = hbs_render_new(template, &handlers);
+    TEST_ASSERT_NOT_NULL(render);
+    TEST_ASSERT_EQUAL_INT(HBS_ERROR_BUDGET, hbs_render_resume(render));
+    TEST_ASSERT_NULL(hbs_render_take_output(render));
+    TEST_ASSERT_EQUAL_INT(HBS_ERROR_BUDGET, hbs_render_resume(render));
+    hbs_render_free(render);
+
+    // Output emitted by hbs_render_step() counts, too.
+    render = hbs_render_new(template, &handlers);
+    TEST_ASSERT_NOT_NULL(render);
+    char buffer[8];
+    size_t written = 0;
+    HbsResult status = HBS_OK;
+    do {
+        status = hbs_render_step(render, buffer, sizeof(buffer), &written);
+    } while (HBS_OK == status && 0 < written);
+    TEST_ASSERT_EQUAL_INT(HBS_ERROR_BUDGET, status);
+    hbs_render_free(render);
+    hbs_template_free(template);
+
+    // A long render runs out of time.
+    HbsString* source = hbs_string_new();
+    for (size_t i = 0; i < 1000; ++i) {
+        hbs_string_append_str(source, "{{quick}} ");
+    }
+    input = hbs_input_context_from_string(source->string);
+    template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+    hbs_input_context_free(input);
+    hbs_string_free(source);
+
+    handlers = (HbsHandlers){
+        .key_handler = basic_key_handler,
+        .time_limit = 1,
+    };
+    TEST_ASSERT_NULL(hbs_template_render(template, &handlers));
+    handlers.time_limit = 60000000000;
+    result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_INT(7000, result->length);
+    hbs_string_free(result);
+    hbs_template_free(template);
+}
+
+TEST(HbsTemplate, Stats) {
+    HbsInputContext* input = hbs_input_context_from_string(BASIC_TEST);
+    HbsTemplate* template = hbs_template_load(input);
+    TEST_ASSERT_NOT_NULL(template);
+    hbs_input_context_free(input);
+
+    HbsTemplateStats stats;
+    if (0 != hbs_template_stats(template, &stats)) {
+        hbs_template_free(template);
+        TEST_IGNORE_MESSAGE("Built without statistics");
+    }
+    TEST_ASSERT_EQUAL_INT(0, stats.renders);
+    TEST_ASSERT_NOT_EQUAL(0, stats.component_size);
+    TEST_ASSERT_NOT_EQUAL(0, stats.string_size);
+    TEST_ASSERT_NOT_EQUAL(0, stats.node_size);
+
+    // Renders are only counted once they complete.
+    HbsHandlers handlers = {.key_handler = basic_key_handler};
+    HbsString* result = hbs_template_render(template, &handlers);
+    TEST_ASSERT_NOT_NULL(result);
+    hbs_string_free(result);
+    HbsRender* render = hbs_render_new(template, &handlers);
+    TEST_ASSERT_NOT_NULL(render);
+    char buffer[8];
+    size_t written = 0;
+    TEST_ASSERT_EQUAL_INT(HBS_OK, hbs_render_step(render, buffer,
+            sizeof(buffer), &written));
+    hbs_template_stats(template, &stats);
+    TEST_ASSERT_EQUAL_INT(1, stats.renders);
+    do {
+        TEST_ASSERT_EQUAL_INT(HBS_OK, hbs_render_step(render, buffer,
+                sizeof(buffer), &written));
+    } while (0 < written);
+    hbs_render_free(render);
+
+    hbs_template_stats(template, &stats);
+    TEST_ASSERT_EQUAL_INT(2, stats.renders);
+    TEST_ASSERT_EQUAL_INT(40, stats.bytes);
+    TEST_ASSERT_EQUAL_INT(2, stats.handler_calls);
+    TEST_ASSERT_TRUE(stats.max_render_time <= stats.render_time);
+    TEST_ASSERT_TRUE(stats.handler_time <= stats.render_time);
+
+    HbsString* output = hbs_string_new();
+    const char* names[] = {"say \"hi\""};
+    TEST_ASSERT_EQUAL_INT(0, hbs_template_stats_prometheus(output, names,
+            &stats, 1));
+    TEST_ASSERT_NOT_NULL(strstr(output->string,
+            "# TYPE hbs_template_renders_total counter\n"
+            "hbs_template_renders_total{template=\"say \\\"hi\\\"\"} 2\n"));
+    TEST_ASSERT_NOT_NULL(strstr(output->string, "hbs_template_output_bytes"
+            "_total{template=\"say \\\"hi\\\"\"} 40\n"));
+    hbs_string_free(output);
+    hbs_template_free(template);
+}
+
+TEST(HbsTemplate, LoadError) {
+    HbsInputContext* input = hbs_input_context_from_string(
+        "Hello,\nworld {{test {{");
+    TEST_ASSERT_NULL(hbs_template_load(input));
+    hbs_input_context_free(input);
+    HbsParseError error = {0};
+    TEST_ASSERT_EQUAL_INT(0, hbs_template_last_error(&error));
+    TEST_ASSERT_EQUAL_INT(2, error.line);
+    TEST_ASSERT_EQUAL_INT(13, error.column);
+
+    // Only syntax errors have a location.
+    input = hbs_input_context_from_string("{{#with a}}");
+    TEST_ASSERT_NULL(hbs_template_load(input));
+    hbs_input_context_free(input);
+    TEST_ASSERT_NOT_EQUAL(0, hbs_template_last_error(&error));
+
+    HbsTemplateSet* set = hbs_template_set_new(NULL);
+    TEST_ASSERT_NOT_NULL(set);
+    input = hbs_input_context_from_string("{{a}}\n  {{}}");
+    TEST_ASSERT_NOT_EQUAL(0, hbs_template_set_add(set, "broken", input));
+    hbs_input_context_free(input);
+    TEST_ASSERT_EQUAL_INT(0, hbs_template_last_error(&error));
+    TEST_ASSERT_EQUAL_INT(2, error.line);
+    TEST_ASSERT_EQUAL_INT(2, error.column);
+    hbs_template_set_free(set);
+
+    // Tentative parses of an edit aren't reported, even at the start.
+    input = hbs_input_context_from_string("{{a}} b");
+    HbsTemplate* template = hbs_template_load_editable(input, NULL);
+    TEST_ASSERT_NOT_NULL(template);
+    hbs_input_context_free(input);
+    input = hbs_input_context_from_string("\n\n{{");
+    TEST_ASSERT_NULL(hbs_template_load(input));
+    hbs_input_context_free(input);
+    TEST_ASSERT_NOT_EQUAL(0, hbs_template_apply_edit(template, 0, 0, "{{",
+            2));
+    TEST_ASSERT_EQUAL_INT(0, hbs_template_last_error(&error));
+    TEST_ASSERT_EQUAL_INT(3, error.line);
+    hbs_template_free(template);
+}
+
 TEST_GROUP_RUNNER(HbsTemplate) {
     RUN_TEST_CASE(HbsTemplate, Basic);
+    RUN_TEST_CASE(HbsTemplate, TypedValue);
+    RUN_TEST_CASE(HbsTemplate, DoubleValue);
+    RUN_TEST_CASE(HbsTemplate, WriteHandler);
+    RUN_TEST_CASE(HbsTemplate, Memoize);
+    RUN_TEST_CASE(HbsTemplate, Prefetch);
+    RUN_TEST_CASE(HbsTemplate, Pending);
+    RUN_TEST_CASE(HbsTemplate, Step);
+    RUN_TEST_CASE(HbsTemplate, Stream);
+    RUN_TEST_CASE(HbsTemplate, StreamError);
+    RUN_TEST_CASE(HbsTemplate, LoadMany);
+    RUN_TEST_CASE(HbsTemplate, Lazy);
+    RUN_TEST_CASE(HbsTemplate, Path);
+    RUN_TEST_CASE(HbsTemplate, Block);
+    RUN_TEST_CASE(HbsTemplate, DataVariable);
+    RUN_TEST_CASE(HbsTemplate, Helper);
+    RUN_TEST_CASE(HbsTemplate, Subexpression);
+    RUN_TEST_CASE(HbsTemplate, PureHelper);
+    RUN_TEST_CASE(HbsTemplate, TemplateSet);
+    RUN_TEST_CASE(HbsTemplate, PendingPartial);
+    RUN_TEST_CASE(HbsTemplate, Layout);
+    RUN_TEST_CASE(HbsTemplate, Specialize);
+    RUN_TEST_CASE(HbsTemplate, Rerender);
+    RUN_TEST_CASE(HbsTemplate, Edit);
+    RUN_TEST_CASE(HbsTemplate, EditBlock);
+    RUN_TEST_CASE(HbsTemplate, Budget);
+    RUN_TEST_CASE(HbsTemplate, Stats);
+    RUN_TEST_CASE(HbsTemplate, LoadError);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,7 @@
 //
 // CREATED:         01/03/2022
 //
-// LAST EDITED:     01/07/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -163,6 +163,20 @@ TEST(HbsParser, Multiple) {
     parser_check_root(&iterator);
 }
 
+static const char* PATH_TEST = "{{./name a/b this}}";
+TEST(HbsParser, Path) {
+    parser_verification_setup(PATH_TEST);
+    TEST_ASSERT_EQUAL_INT(0, hbs_parser_parse(parser, &tree));
+    TEST_ASSERT_NOT_NULL(tree);
+
+    HbsNaryTreeIter iterator;
+    hbs_nary_tree_iter_init(&iterator, tree);
+    static const char* argv[] = {"./name", "a/b", "this"};
+    parser_check_expression_component(&iterator,
+        sizeof(argv) / sizeof(argv[0]), argv);
+    parser_check_root(&iterator);
+}
+
 static const char* UNCLOSED_EXPRESSION_ERROR_TEST = "{{test";
 TEST(HbsParser, UnclosedExpressionError) {
     parser_verification_setup(UNCLOSED_EXPRESSION_ERROR_TEST);
@@ -191,11 +205,38 @@ TEST(HbsParser, EmptyExpressionError) {
     TEST_ASSERT_NULL(tree);
 }
 
+static const char* ERROR_LOCATION_TEST = "Hello,\nworld {{test {{";
+TEST(HbsParser, ErrorLocation) {
+    parser_verification_setup(ERROR_LOCATION_TEST);
+    size_t line = 0;
+    size_t column = 0;
+    TEST_ASSERT_NOT_EQUAL(0, hbs_parser_error_location(parser, &line,
+            &column));
+    TEST_ASSERT_EQUAL_INT(1, hbs_parser_parse(parser, &tree));
+    TEST_ASSERT_EQUAL_INT(0, hbs_parser_error_location(parser, &line,
+            &column));
+    TEST_ASSERT_EQUAL_INT(2, line);
+    TEST_ASSERT_EQUAL_INT(13, column);
+}
+
 static const char* BLOCK_EXPRESSION_BASIC_TEST = "{{#block}}test{{/block}}";
 TEST(HbsParser, BlockExpressionBasic) {
     parser_verification_setup(BLOCK_EXPRESSION_BASIC_TEST);
     TEST_ASSERT_EQUAL_INT(0, hbs_parser_parse(parser, &tree));
     TEST_ASSERT_NOT_NULL(tree);
+
+    HbsNaryTreeIter iterator;
+    hbs_nary_tree_iter_init(&iterator, tree);
+    HbsComponent* component = hbs_nary_node_get_data(
+        hbs_nary_tree_iter_next(&iterator));
+    TEST_ASSERT_EQUAL_INT(HBS_COMPONENT_BLOCK_OPEN, component->type);
+    TEST_ASSERT_EQUAL_STRING("block",
+        ((HbsString*)component->argv->vector[0])->string);
+    parser_check_text_component(&iterator, "test");
+    component = hbs_nary_node_get_data(hbs_nary_tree_iter_next(&iterator));
+    TEST_ASSERT_EQUAL_INT(HBS_COMPONENT_BLOCK_CLOSE, component->type);
+    TEST_ASSERT_EQUAL_INT(1, component->argv->length);
+    parser_check_root(&iterator);
 }
 
 TEST_GROUP_RUNNER(HbsParser) {
@@ -203,10 +244,12 @@ TEST_GROUP_RUNNER(HbsParser) {
     RUN_TEST_CASE(HbsParser, Handlebars);
     RUN_TEST_CASE(HbsParser, Combination);
     RUN_TEST_CASE(HbsParser, Multiple);
+    RUN_TEST_CASE(HbsParser, Path);
     RUN_TEST_CASE(HbsParser, UnclosedExpressionError);
     RUN_TEST_CASE(HbsParser, MismatchedHandlebarsError);
     RUN_TEST_CASE(HbsParser, NestedExpressionError);
     RUN_TEST_CASE(HbsParser, EmptyExpressionError);
+    RUN_TEST_CASE(HbsParser, ErrorLocation);
     RUN_TEST_CASE(HbsParser, BlockExpressionBasic);
 }
 
@@ -7,7 +7,7 @@
 //
 // CREATED:         12/29/2021
 //
-// LAST EDITED:     01/07/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -73,12 +73,16 @@ void scanner_token_compare(HbsParseTokenType type, const char* string, int line,
         TEST_ASSERT_EQUAL_STRING(string, token.string->string);
     }
 
+    size_t token_line = 0;
+    size_t token_column = 0;
+    TEST_ASSERT_EQUAL_INT(0, hbs_scanner_locate(scanner, token.offset,
+            &token_line, &token_column));
     if (-1 != line) {
-        TEST_ASSERT_EQUAL_INT(line, token.line);
+        TEST_ASSERT_EQUAL_INT(line, token_line);
     }
 
     if (-1 != column) {
-        TEST_ASSERT_EQUAL_INT(column, token.column);
+        TEST_ASSERT_EQUAL_INT(column, token_column);
     }
 
     hbs_token_release(&token);
@@ -155,6 +159,72 @@ TEST(HbsScanner, Peek) {
     scanner_token_compare(HBS_TOKEN_EOF, NULL, 1, 2);
 }
 
+static const char* PEEK_N_TEST = "{{#a}}{{#b}}{{#c}}{{/c}}{{/b}}{{/a}}";
+TEST(HbsScanner, PeekN) {
+    scanner_token_verification_setup(PEEK_N_TEST);
+    hbs_scanner_enable_hbs_tokens(scanner);
+    TEST_ASSERT_EQUAL_INT(HBS_TOKEN_CLOSE_BARS, hbs_scanner_peek_n(scanner,
+            23));
+    TEST_ASSERT_EQUAL_INT(HBS_TOKEN_EOF, hbs_scanner_peek_n(scanner, 24));
+    TEST_ASSERT_EQUAL_INT(HBS_TOKEN_EOF, hbs_scanner_peek_n(scanner, 100));
+    TEST_ASSERT_EQUAL_INT(HBS_TOKEN_SLASH, hbs_scanner_peek_n(scanner, 13));
+    TEST_ASSERT_EQUAL_INT(HBS_TOKEN_OPEN_BARS, hbs_scanner_peek(scanner));
+    scanner_token_compare(HBS_TOKEN_OPEN_BARS, NULL, 1, 0);
+    TEST_ASSERT_EQUAL_INT(HBS_TOKEN_HASH, hbs_scanner_peek(scanner));
+    scanner_token_compare(HBS_TOKEN_HASH, NULL, 1, 2);
+    scanner_token_compare(HBS_TOKEN_TEXT, "a", 1, 3);
+    scanner_token_compare(HBS_TOKEN_CLOSE_BARS, NULL, 1, 4);
+}
+
+static const char* SINGLE_BRACE_TEST = "a{b}c {{";
+TEST(HbsScanner, SingleBrace) {
+    scanner_token_verification_setup(SINGLE_BRACE_TEST);
+    scanner_token_compare(HBS_TOKEN_TEXT, "a{b}c ", 1, 0);
+    scanner_token_compare(HBS_TOKEN_OPEN_BARS, NULL, 1, 6);
+    scanner_token_compare(HBS_TOKEN_EOF, NULL, 1, 8);
+}
+
+static const char* CONTROL_WHITESPACE_TEST = "a\r\v\fb";
+TEST(HbsScanner, ControlWhitespace) {
+    scanner_token_verification_setup(CONTROL_WHITESPACE_TEST);
+    hbs_scanner_enable_hbs_tokens(scanner);
+    scanner_token_compare(HBS_TOKEN_TEXT, "a", 1, 0);
+    scanner_token_compare(HBS_TOKEN_WS, "\r\v\f", 1, 1);
+    scanner_token_compare(HBS_TOKEN_TEXT, "b", 1, 4);
+    scanner_token_compare(HBS_TOKEN_EOF, NULL, 1, 5);
+}
+
+static const char* STRING_TEST = "\"b c\" 'd\\'e' f\"g";
+TEST(HbsScanner, String) {
+    scanner_token_verification_setup(STRING_TEST);
+    hbs_scanner_enable_hbs_tokens(scanner);
+    scanner_token_compare(HBS_TOKEN_STRING, "\"b c\"", 1, 0);
+    scanner_token_compare(HBS_TOKEN_WS, " ", 1, 5);
+    scanner_token_compare(HBS_TOKEN_STRING, "'d\\'e'", 1, 6);
+    scanner_token_compare(HBS_TOKEN_WS, " ", 1, 12);
+    scanner_token_compare(HBS_TOKEN_TEXT, "f", 1, 13);
+    scanner_token_compare(HBS_TOKEN_STRING, "\"g", 1, 14);
+    scanner_token_compare(HBS_TOKEN_EOF, NULL, 1, 16);
+}
+
+static const char* PAREN_TEST = "a (b c) (d)";
+TEST(HbsScanner, Paren) {
+    scanner_token_verification_setup(PAREN_TEST);
+    hbs_scanner_enable_hbs_tokens(scanner);
+    scanner_token_compare(HBS_TOKEN_TEXT, "a", 1, 0);
+    scanner_token_compare(HBS_TOKEN_WS, " ", 1, 1);
+    scanner_token_compare(HBS_TOKEN_OPEN_PAREN, NULL, 1, 2);
+    scanner_token_compare(HBS_TOKEN_TEXT, "b", 1, 3);
+    scanner_token_compare(HBS_TOKEN_WS, " ", 1, 4);
+    scanner_token_compare(HBS_TOKEN_TEXT, "c", 1, 5);
+    scanner_token_compare(HBS_TOKEN_CLOSE_PAREN, NULL, 1, 6);
+    scanner_token_compare(HBS_TOKEN_WS, " ", 1, 7);
+    scanner_token_compare(HBS_TOKEN_OPEN_PAREN, NULL, 1, 8);
+    scanner_token_compare(HBS_TOKEN_TEXT, "d", 1, 9);
+    scanner_token_compare(HBS_TOKEN_CLOSE_PAREN, NULL, 1, 10);
+    scanner_token_compare(HBS_TOKEN_EOF, NULL, 1, 11);
+}
+
 TEST_GROUP_RUNNER(HbsScanner) {
     RUN_TEST_CASE(HbsScanner, Basic);
     RUN_TEST_CASE(HbsScanner, Token);
@@ -163,6 +233,11 @@ TEST_GROUP_RUNNER(HbsScanner) {
     RUN_TEST_CASE(HbsScanner, DoubleWhitespace);
     RUN_TEST_CASE(HbsScanner, BlockTokens);
     RUN_TEST_CASE(HbsScanner, Peek);
+    RUN_TEST_CASE(HbsScanner, PeekN);
+    RUN_TEST_CASE(HbsScanner, SingleBrace);
+    RUN_TEST_CASE(HbsScanner, ControlWhitespace);
+    RUN_TEST_CASE(HbsScanner, String);
+    RUN_TEST_CASE(HbsScanner, Paren);
 }
 
 ///////////////////////////////////////////////////////////////////////////////